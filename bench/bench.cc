@@ -0,0 +1,290 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: bench.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+// Fixed generator workloads for "make bench". The equations are those of prep/generate_*.cc,
+// but they are built in process, so that no main.cc has to be regenerated.
+// The theory is a compile-time switch (see constants.h), hence one binary per theory.
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <functional>
+#include "constants.h"
+#include "forest.h"
+#include "residual.h"
+#include "parallel.h"
+#include "stats.h"
+
+using namespace std;
+using namespace smith;
+
+namespace {
+
+/// Excitation classes (l, k, j, i) of the projection manifold, in the order of create_proj() in prep/generate_*.cc.
+const vector<array<string,4>> classes__ = {{{_C, _C, _X, _X}}, {{_X, _C, _X, _X}}, {{_C, _C, _X, _A}}, {{_X, _C, _X, _A}}, {{_C, _X, _X, _A}},
+                                           {{_X, _X, _X, _A}}, {{_C, _C, _A, _A}}, {{_X, _C, _A, _A}}, {{_X, _X, _A, _A}}};
+
+/// In-process counterpart of the equations in prep/equation.h and the main.cc they generate.
+class Workload {
+  protected:
+    std::string theory_;
+    /// Operators with {a, a, c, c} or {c, c, a, a} indices, see Tensor::external() in prep/tensor.h.
+    std::set<std::shared_ptr<Operator>> external_;
+    std::list<std::shared_ptr<Tree>> trees_;
+
+  public:
+    std::vector<std::shared_ptr<Operator>> proj, t2, t2dagger, l2, l2dagger;
+    std::vector<std::shared_ptr<Operator>> f1, h1, v2, dum, ex1b;
+
+    Workload(const std::string theory, const bool skip_xcxa = false) : theory_(theory) {
+      for (auto& c : classes__) {
+        if (skip_xcxa && c == array<string,4>{{_X, _C, _X, _A}}) continue;
+        proj.push_back(make_shared<Op>(c[0], c[1], c[2], c[3]));
+        t2dagger.push_back(make_shared<Op>("t2dagger", c[0], c[1], c[2], c[3]));
+        t2.push_back(make_shared<Op>("t2", c[2], c[3], c[0], c[1]));
+        l2dagger.push_back(make_shared<Op>("l2dagger", c[0], c[1], c[2], c[3]));
+        l2.push_back(make_shared<Op>("l2", c[2], c[3], c[0], c[1]));
+        if ((c[0] == _A && c[1] == _A && c[2] == _C && c[3] == _C) || (c[0] == _C && c[1] == _C && c[2] == _A && c[3] == _A)) {
+          external_.insert(proj.back());
+          external_.insert(t2.back());
+        }
+      }
+      f1 = {make_shared<Op>("f1", _G, _G)};
+      h1 = {make_shared<Op>("h1", _G, _G)};
+      v2 = {make_shared<Op>("v2", _G, _G, _G, _G)};
+      dum = {make_shared<Op>("proj")};
+      ex1b = {make_shared<Op>(_G, _G)};
+    }
+
+    /// Equation of all the combinations of the operator lists.
+    std::shared_ptr<Equation> equation(const std::string label, const std::vector<std::vector<std::shared_ptr<Operator>>> in, const double fac = 1.0,
+                                       const std::string scalar = "", const std::pair<bool,bool> braket = std::make_pair(false,false)) const {
+      std::shared_ptr<Equation> out;
+      std::vector<size_t> current(in.size(), 0);
+      while (true) {
+        std::list<std::shared_ptr<Operator>> ops;
+        for (int i = 0; i != in.size(); ++i) ops.push_back(in[i][current[i]]);
+        // diagonal cc/aa will be removed from the CASPT2 residual equation for efficiency.
+        const bool diagonal = (theory_ == "CASPT2" || theory_ == "RelCASPT2") && label[0] == 'r' && ops.front()->label() == "proj"
+                           && external_.count(ops.back()) && external_.count(*++ops.begin());
+        if (!diagonal) {
+          auto eq = make_shared<Equation>(make_shared<Diagram>(ops, fac, scalar, braket), theory_);
+          if (out) out->merge(eq);
+          else     out = eq;
+        }
+        int i = in.size() - 1;
+        for ( ; i >= 0; --i) {
+          if (++current[i] != in[i].size()) break;
+          current[i] = 0;
+        }
+        if (i < 0) break;
+      }
+      return out;
+    }
+
+    /// Processes an equation as in the generated main.cc and makes a residual tree of it.
+    void tree(std::shared_ptr<Equation> eq, const std::string name, const bool ci = false) {
+      if (ci) eq->absorb_ket();
+      eq->duplicates();
+      eq->active();
+      if (theory_ != "CASPT2" && theory_ != "RelCASPT2" && theory_ != "MSCASPT2" && theory_ != "SPCASPT2") {
+        eq->reorder_tensors();
+        eq->simplify();
+      }
+      trees_.push_back(make_shared<Residual>(eq, name));
+    }
+
+    /// Runs the forest and returns the number of bytes of code generated (zero if code is not generated).
+    size_t generate(const bool code) const {
+      auto fr = make_shared<Forest>(trees_);
+      fr->filter_gamma();
+      fr->hoist_invariants();
+      fr->share_intermediates();
+      if (!code) return 0;
+      OutStream out = fr->generate_code();
+      return out.ss.str().size() + out.tt.str().size() + out.cc.str().size() + out.dd.str().size() + out.ee.str().size() + out.gg.str().size();
+    }
+};
+
+
+size_t caspt2__(const bool mscaspt2) {
+  Workload w(mscaspt2 ? "MSCASPT2" : "CASPT2");
+  const pair<bool,bool> bra(true, false), ket(false, true);
+  if (mscaspt2) {
+    w.tree(w.equation("da", {w.dum, w.t2dagger, w.ex1b, w.l2}), "density");
+    w.tree(w.equation("db", {w.dum, w.ex1b, w.l2}), "density1");
+    w.tree(w.equation("d2a", {w.dum, w.proj, w.l2}), "density2");
+    w.tree(w.equation("dedcia", {w.dum, w.l2dagger, w.f1, w.t2}, 1.0, "", bra), "deci", true);
+    w.tree(w.equation("dedcic", {w.dum, w.l2dagger, w.t2}, -1.0, "e0", bra), "deci2", true);
+    auto eq4d = w.equation("dedcie", {w.dum, w.l2dagger, w.v2}, 0.5, "", bra);
+    eq4d->merge(w.equation("dedcig", {w.dum, w.l2dagger, w.h1}, 1.0, "", bra));
+    w.tree(eq4d, "deci3", true);
+    auto eq4e = w.equation("dedcif", {w.dum, w.l2dagger, w.v2}, 0.5, "", ket);
+    eq4e->merge(w.equation("dedcih", {w.dum, w.l2dagger, w.h1}, 1.0, "", ket));
+    w.tree(eq4e, "deci4", true);
+    return w.generate(true);
+  }
+  auto eq0 = w.equation("ra", {w.dum, w.proj, w.f1, w.t2});
+  eq0->merge(w.equation("rb", {w.dum, w.proj, w.t2}, -1.0, "e0"));
+  w.tree(eq0, "residual");
+  auto eq3 = w.equation("ec", {w.dum, w.proj, w.v2}, 0.5);
+  eq3->merge(w.equation("ed", {w.dum, w.proj, w.h1}));
+  w.tree(eq3, "source");
+  w.tree(w.equation("ca", {w.dum, w.proj, w.t2}), "norm");
+  w.tree(w.equation("da", {w.dum, w.t2dagger, w.ex1b, w.t2}), "density");
+  w.tree(w.equation("db", {w.dum, w.ex1b, w.t2}), "density1");
+  w.tree(w.equation("d2a", {w.dum, w.proj, w.t2}), "density2");
+  auto eq4 = w.equation("dedcia", {w.dum, w.t2dagger, w.f1, w.t2}, 2.0, "", bra);
+  eq4->merge(w.equation("dedcic", {w.dum, w.t2dagger, w.t2}, -2.0, "e0", bra));
+  eq4->merge(w.equation("dedcie", {w.dum, w.t2dagger, w.v2}, 1.0, "", bra));
+  eq4->merge(w.equation("dedcif", {w.dum, w.t2dagger, w.v2}, 1.0, "", ket));
+  eq4->merge(w.equation("dedcig", {w.dum, w.t2dagger, w.h1}, 2.0, "", bra));
+  eq4->merge(w.equation("dedcih", {w.dum, w.t2dagger, w.h1}, 2.0, "", ket));
+  w.tree(eq4, "deci", true);
+  return w.generate(true);
+}
+
+
+size_t relcaspt2__() {
+  Workload w("RelCASPT2");
+  auto eq0 = w.equation("ra", {w.dum, w.proj, w.f1, w.t2});
+  eq0->merge(w.equation("rb", {w.dum, w.proj, w.t2}, -1.0, "e0"));
+  w.tree(eq0, "residual");
+  auto eq3 = w.equation("sb", {w.dum, w.proj, w.v2}, 0.5);
+  eq3->merge(w.equation("sa", {w.dum, w.proj, w.h1}));
+  w.tree(eq3, "source");
+  w.tree(w.equation("ca", {w.dum, w.proj, w.t2}), "norm");
+  return w.generate(true);
+}
+
+
+size_t mrci__(const bool rel) {
+  Workload w(rel ? "RelMRCI" : "MRCI", rel);
+  auto eq0 = w.equation("ra", {w.dum, w.proj, w.h1, w.t2});
+  eq0->merge(w.equation("rb", {w.dum, w.proj, w.v2, w.t2}, 0.5));
+  for (int i = 0; i != w.proj.size(); ++i) {
+    // MRCI treats the two x c x a classes together
+    if (!rel && (i == 3 || i == 4)) continue;
+    eq0->merge(w.equation("ra_", {w.dum, {w.proj[i]}, {w.t2[i]}, w.h1}, -1.0));
+    eq0->merge(w.equation("rb_", {w.dum, {w.proj[i]}, {w.t2[i]}, w.v2}, -0.5));
+  }
+  if (!rel) {
+    eq0->merge(w.equation("ra_", {w.dum, {w.proj[3], w.proj[4]}, {w.t2[3], w.t2[4]}, w.h1}, -1.0));
+    eq0->merge(w.equation("rb_", {w.dum, {w.proj[3], w.proj[4]}, {w.t2[3], w.t2[4]}, w.v2}, -0.5));
+  }
+  w.tree(eq0, "residual");
+  auto eq3 = w.equation("sa", {w.dum, w.proj, w.h1});
+  eq3->merge(w.equation("sb", {w.dum, w.proj, w.v2}, 0.5));
+  w.tree(eq3, "source");
+  w.tree(w.equation("rc", {w.dum, w.proj, w.t2}), "norm");
+  // code generation of the MRCI trees stops at an assertion in RDM00::generate_merged, so only the symbolic part is timed
+  return w.generate(false);
+}
+
+
+/// Workloads and the theory they need to be compiled for.
+const map<string, function<size_t()>> workloads__ = {
+#if defined(_CASPT2) && defined(_MULTI_DERIV)
+  {"caspt2",    [](){ return caspt2__(false); }},
+  {"mscaspt2",  [](){ return caspt2__(true); }},
+#endif
+#ifdef _MRCI
+  {"mrci",      [](){ return mrci__(false); }},
+#endif
+#ifdef _RELCASPT2
+  {"relcaspt2", relcaspt2__},
+#endif
+#ifdef _RELMRCI
+  {"relmrci",   [](){ return mrci__(true); }},
+#endif
+};
+
+
+/// Reads "workload wall rss bytes" lines; lines starting with # are comments.
+map<string, array<double,3>> read_baseline__(const string& file) {
+  map<string, array<double,3>> out;
+  ifstream fs(file);
+  if (!fs) throw runtime_error("cannot open " + file);
+  string line;
+  while (getline(fs, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    stringstream ss(line);
+    string name;
+    array<double,3> v;
+    if (ss >> name >> v[0] >> v[1] >> v[2]) out[name] = v;
+  }
+  return out;
+}
+
+
+string change__(const double now, const double base) {
+  stringstream ss;
+  if (base == 0.0) ss << "       -";
+  else             ss << showpos << fixed << setprecision(1) << setw(7) << (now/base-1.0)*100.0 << "%";
+  return ss.str();
+}
+
+}
+
+
+int main(int argc, char** argv) {
+  string workload, baseline;
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+    if (arg == "--baseline" && i+1 < argc) baseline = argv[++i];
+    else if (arg == "--threads" && i+1 < argc) set_num_threads(atoi(argv[++i]));
+    else if (workload.empty() && arg[0] != '-') workload = arg;
+    else throw runtime_error("usage: " + string(argv[0]) + " workload [--baseline file] [--threads n]");
+  }
+  auto w = workloads__.find(workload);
+  if (w == workloads__.end()) {
+    cerr << "workload \"" << workload << "\" is not available in " << argv[0] << "; available:";
+    for (auto& i : workloads__) cerr << " " << i.first;
+    cerr << endl;
+    return 1;
+  }
+
+  auto start = chrono::steady_clock::now();
+  const size_t bytes = w->second();
+  const double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  const long rss = Stats::peak_rss();
+
+  // one line per workload, in the format of the baseline file
+  cout << left << setw(12) << workload << right << fixed << setprecision(3) << setw(10) << wall << setw(10) << rss << setw(12) << bytes;
+  if (!baseline.empty()) {
+    auto base = read_baseline__(baseline);
+    auto b = base.find(workload);
+    if (b != base.end())
+      cout << "   # time " << change__(wall, b->second[0]) << "  memory " << change__(rss, b->second[1]) << "  output " << change__(bytes, b->second[2]);
+    else
+      cout << "   # not in baseline";
+  }
+  cout << endl;
+  return 0;
+}
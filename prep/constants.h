@@ -67,11 +67,15 @@ static std::string header() {
   mm << "#include \"constants.h\"" << std::endl;
   mm << "#include \"forest.h\"" << std::endl;
   mm << "#include \"residual.h\"" << std::endl;
+  mm << "#include \"estimate.h\"" << std::endl;
+  mm << "#include \"option.h\"" << std::endl;
+  mm << "#include \"stats.h\"" << std::endl;
   mm << "" << std::endl;
   mm << "using namespace std;" << std::endl;
   mm << "using namespace smith;" << std::endl;
   mm << "" << std::endl;
-  mm << "int main() {" << std::endl;
+  mm << "int main(int argc, char** argv) {" << std::endl;
+  mm << "  parse_options(argc, argv);" << std::endl;
   return mm.str();
 }
 
@@ -101,31 +105,19 @@ static std::string footer(const std::string res, const std::string energy = "",
 
   mm << "" <<  std::endl;
   mm << "  fr->filter_gamma();" << std::endl;
+  mm << "  fr->hoist_invariants();" << std::endl;
+  mm << "  fr->share_intermediates();" << std::endl;
   mm << "  list<shared_ptr<Tensor>> gm = fr->gamma();" << std::endl;
   mm << "  const list<shared_ptr<Tensor>> gamma = gm;" << std::endl;
 
   mm << "" <<  std::endl;
-  mm << "  auto tmp = fr->generate_code();" << std::endl;
-
-  mm << "" <<  std::endl;
-  mm << "  ofstream fs(fr->name() + \".h\");" << std::endl;
-  mm << "  ofstream es(fr->name() + \"_tasks.h\");" << std::endl;
-  mm << "  ofstream cs(fr->name() + \"_gen.cc\");" << std::endl;
-  mm << "  ofstream ds(fr->name() + \"_tasks.cc\");" << std::endl;
-  mm << "  ofstream gs(fr->name() + \".cc\");" << std::endl;
-  mm << "  ofstream gg(fr->name() + \"_gamma.cc\");" << std::endl;
-  mm << "  fs << tmp.ss.str();" << std::endl;
-  mm << "  es << tmp.tt.str();" << std::endl;
-  mm << "  cs << tmp.cc.str();" << std::endl;
-  mm << "  ds << tmp.dd.str();" << std::endl;
-  mm << "  gs << tmp.ee.str();" << std::endl;
-  mm << "  gg << tmp.gg.str();" << std::endl;
-  mm << "  fs.close();" << std::endl;
-  mm << "  es.close();" << std::endl;
-  mm << "  cs.close();" << std::endl;
-  mm << "  ds.close();" << std::endl;
-  mm << "  gs.close();" << std::endl;
-  mm << "  gg.close();" << std::endl;
+  mm << "  // the generated code is written to the files as it is generated" << std::endl;
+  mm << "  OutStream out(fr->name(), fr->queues());" << std::endl;
+  mm << "  fr->generate_code(out);" << std::endl;
+  mm << "  out.close();" << std::endl;
+  mm << "  Estimate::write(fr->name() + \"_estimates.json\");" << std::endl;
+  mm << "  for (auto i : {&out.ss, &out.tt, &out.cc, &out.dd, &out.ee, &out.gg})" << std::endl;
+  mm << "    Stats::count(\"bytes \" + i->file(), i->size());" << std::endl;
   mm << "  cout << std::endl;" << std::endl;
   mm << "" <<  std::endl;
   mm << "  // output" << std::endl;
@@ -179,6 +171,8 @@ static std::string footer(const std::string res, const std::string energy = "",
     mm << "  " << dedci4 << "->print();" << std::endl;
   }
   mm << "  cout << std::endl << std::endl;" << std::endl;
+  mm << "  cout << ListTensor::orderings();" << std::endl;
+  mm << "  Stats::report();" << std::endl;
   mm << "" <<  std::endl;
   mm << "  return 0;" << std::endl;
   mm << "}" << std::endl;
@@ -3,9 +3,4 @@ make -j
 ./prep/Prep > ../src/main.cc
 make -j
 rm -f CASPT2*
-./SMITH3
-./header_split.py
-./tasks_split.py
-./gen_split.py
-./queue_split.py
-./gamma.py
+./SMITH3 --shard 50
@@ -25,26 +25,92 @@
 
 #include <algorithm>
 #include <iomanip>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_map>
 #include "active.h"
+#include "stats.h"
 
 using namespace std;
 using namespace smith;
 
+atomic<long> Active::nreduce_(0);
+atomic<long> Active::nreduce_hit_(0);
+
+namespace {
+
+/// An index of a reduced RDM relative to the input string: position of its core, whether it is the input object itself, and position of its spin (-1 if unset).
+struct IndexTemplate {
+  int pos;
+  bool same;
+  int spin;
+};
+
+/// A reduced RDM stored in terms of positions in the input string.
+struct RDMTemplate {
+  double fac;
+  vector<IndexTemplate> index;
+  vector<pair<IndexTemplate, IndexTemplate>> delta;
+};
+
+mutex memo_mutex__;
+unordered_map<string, vector<RDMTemplate>> memo__;
+
+/// Canonical string of an RDM to be reduced: type, bra/ket, and per index its label, dagger, spin class (by first appearance) and alpha. Empty if nums are not unique.
+string reduce_key__(shared_ptr<RDM> in, const vector<shared_ptr<const Index>>& index) {
+  stringstream ss;
+  ss << (dynamic_pointer_cast<RDMI0>(in) ? "I" : "0") << in->bra() << in->ket() << in->fac() << ":" << in->delta().size();
+  vector<int> nums;
+  vector<shared_ptr<Spin>> spins;
+  for (auto& i : index) {
+    if (find(nums.begin(), nums.end(), i->num()) != nums.end()) return "";
+    nums.push_back(i->num());
+    const int s = find(spins.begin(), spins.end(), i->spin()) - spins.begin();
+    if (s == spins.size()) spins.push_back(i->spin());
+    ss << "," << i->label() << (i->dagger() ? "+" : "") << s << (i->spin()->alpha() ? "*" : "");
+  }
+  return ss.str();
+}
+
+bool make_template__(shared_ptr<const Index> o, const vector<shared_ptr<const Index>>& index, IndexTemplate& out) {
+  auto p = find_if(index.begin(), index.end(), [&o](shared_ptr<const Index> i) { return i->num() == o->num(); });
+  if (p == index.end()) return false;
+  out.pos = p - index.begin();
+  out.same = o == *p;
+  out.spin = -1;
+  if (o->has_spin()) {
+    auto s = find_if(index.begin(), index.end(), [&o](shared_ptr<const Index> i) { return i->spin() == o->spin(); });
+    if (s == index.end()) return false;
+    out.spin = s - index.begin();
+  }
+  return true;
+}
+
+shared_ptr<const Index> instantiate__(const IndexTemplate& t, const vector<shared_ptr<const Index>>& index) {
+  if (t.same) return index[t.pos];
+  shared_ptr<Index> out = index[t.pos]->clone();
+  if (t.spin >= 0) out->set_spin(index[t.spin]->spin());
+  return out;
+}
+
+}
+
 
 
 Active::Active(const list<shared_ptr<const Index>>& in, pair<bool,bool> braket) : bra_(braket.first), ket_(braket.second) {
   shared_ptr<RDM> tmp;
   if (!braket.first && !braket.second) {
-    tmp = make_shared<RDM00>(in, map<shared_ptr<const Index>, shared_ptr<const Index>>(), braket, 1.0);
+    tmp = make_shared<RDM00>(in, DeltaMap(), braket, 1.0);
   } else if (braket.first || braket.second) {
     // Caution, braket is passed directly so both modified rdms <I|E|0> and <0|E|I> are made here.
-    tmp = make_shared<RDMI0>(in, map<shared_ptr<const Index>, shared_ptr<const Index>>(), braket, 1.0);
+    tmp = make_shared<RDMI0>(in, DeltaMap(), braket, 1.0);
   } else if (braket.first && braket.second) {
     throw logic_error("Active::ctor not implemented");
   }
-  // this sets list<RDM>
+  // this sets list<RDM>. The reduced RDMs are allocated from an arena that lives as long as they do.
+  Arena::Scope scope(make_shared<Arena>());
   reduce(tmp);
+  Stats::count("rdm terms", rdm_.size());
 
 }
 
@@ -70,6 +136,28 @@ void Active::reduce(shared_ptr<RDM> in) {
     in = tmp;
   }
 
+  // the reduction only depends on the structure of the index string, so reuse it when it has been seen before
+  const vector<shared_ptr<const Index>> index(in->index().begin(), in->index().end());
+  const string key = reduce_key__(in, index);
+  ++nreduce_;
+  if (!key.empty()) {
+    lock_guard<mutex> lock(memo_mutex__);
+    auto iter = memo__.find(key);
+    if (iter != memo__.end()) {
+      ++nreduce_hit_;
+      const bool ci = !!dynamic_pointer_cast<RDMI0>(in);
+      for (auto& t : iter->second) {
+        list<shared_ptr<const Index>> ind;
+        for (auto& i : t.index) ind.push_back(instantiate__(i, index));
+        DeltaMap d;
+        for (auto& i : t.delta) d.insert(make_pair(instantiate__(i.first, index), instantiate__(i.second, index)));
+        const pair<bool,bool> braket(in->bra(), in->ket());
+        if (ci) rdm_.push_back(make_pooled<RDMI0>(ind, d, braket, t.fac));
+        else    rdm_.push_back(make_pooled<RDM00>(ind, d, braket, t.fac));
+      }
+      return;
+    }
+  }
 
   list<int> d;
   list<pair<shared_ptr<RDM>, list<int>> > buf(1, make_pair(in,d));
@@ -97,6 +185,35 @@ void Active::reduce(shared_ptr<RDM> in) {
 
   for (auto& i : rdm_)
     i->sort();
+
+  if (!key.empty()) {
+    vector<RDMTemplate> value;
+    for (auto& i : rdm_) {
+      RDMTemplate t;
+      t.fac = i->fac();
+      for (auto& j : i->index()) {
+        IndexTemplate it;
+        if (!make_template__(j, index, it)) return;
+        t.index.push_back(it);
+      }
+      for (auto& j : i->delta()) {
+        pair<IndexTemplate, IndexTemplate> it;
+        if (!make_template__(j.first, index, it.first) || !make_template__(j.second, index, it.second)) return;
+        t.delta.push_back(it);
+      }
+      value.push_back(t);
+    }
+    lock_guard<mutex> lock(memo_mutex__);
+    memo__.emplace(key, move(value));
+  }
+}
+
+
+string Active::statistics() {
+  stringstream ss;
+  ss << "   ***  Memo  ***" << endl << endl;
+  ss << "  " << nreduce_hit_ << " of " << nreduce_ << " RDM reductions served from memo (" << memo__.size() << " distinct strings)" << endl;
+  return ss.str();
 }
 
 
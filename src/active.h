@@ -31,6 +31,7 @@
 #ifndef __ACTIVE_H
 #define __ACTIVE_H
 
+#include <atomic>
 #include "op.h"
 #include "rdm.h"
 #include "rdm00.h"
@@ -46,6 +47,10 @@ class Active {
     /// This function calls RDM::reduce_one and RDM::reduce_done functions and does sort to apply Wick's theorem to this RDM. Uses anticommutator property to rearrange indices.
     void reduce(std::shared_ptr<RDM> in);
 
+    /// Counters for the memoized reduction, see statistics().
+    static std::atomic<long> nreduce_;
+    static std::atomic<long> nreduce_hit_;
+
     /// if have bra
     bool bra_;
     /// if have ket
@@ -87,6 +92,9 @@ class Active {
     /// Merge two Active's
     void merge(std::shared_ptr<const Active> o, const double fac);
 
+    /// Returns a summary of how many reductions were served from the memo.
+    static std::string statistics();
+
 };
 
 }
@@ -0,0 +1,73 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: arena.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <sstream>
+#include <iomanip>
+#include "arena.h"
+
+using namespace std;
+using namespace smith;
+
+const size_t Arena::min_chunk_;
+const size_t Arena::max_chunk_;
+bool Arena::enabled_ = true;
+atomic<long> Arena::narena_(0);
+atomic<long> Arena::nchunk_(0);
+atomic<long> Arena::nalloc_(0);
+atomic<long> Arena::bytes_(0);
+
+
+void* Arena::allocate(size_t n) {
+  const size_t align = alignof(max_align_t);
+  n = (n + align - 1) / align * align;
+  if (used_ + n > size_) {
+    if (chunks_.empty()) ++narena_;
+    size_ = max(n, min(max_chunk_, max(min_chunk_, 2*size_)));
+    chunks_.emplace_back(new char[size_]);
+    used_ = 0;
+    ++nchunk_;
+  }
+  void* out = chunks_.back().get() + used_;
+  used_ += n;
+  ++nalloc_;
+  bytes_ += n;
+  return out;
+}
+
+
+shared_ptr<Arena>& Arena::current() {
+  thread_local shared_ptr<Arena> out;
+  return out;
+}
+
+
+string Arena::statistics() {
+  stringstream ss;
+  ss << "   ***  Arena  ***" << endl << endl;
+  ss << "  " << nalloc_ << " allocations (" << fixed << setprecision(1) << bytes_/1048576.0 << " MB) served from "
+     << nchunk_ << " chunks in " << narena_ << " arenas" << endl;
+  return ss.str();
+}
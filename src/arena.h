@@ -0,0 +1,119 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: arena.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace smith {
+
+/// Bump allocator for the many small objects (Index, Spin, Operator, ...) that are created while diagrams are copied.
+/// Memory is returned all at once when the arena is destroyed, i.e., when the last object allocated from it is gone.
+/// An arena is used by one thread at a time; see Arena::Scope.
+class Arena {
+  protected:
+    /// Memory chunks.
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    /// Bytes used in the last chunk.
+    size_t used_;
+    /// Size of the last chunk.
+    size_t size_;
+
+    /// Chunk sizes in bytes. Chunks double in size up to the maximum.
+    static const size_t min_chunk_ = 1 << 12;
+    static const size_t max_chunk_ = 1 << 16;
+    /// Whether make_pooled uses arenas at all (--no-arena).
+    static bool enabled_;
+
+    /// Statistics over all arenas.
+    static std::atomic<long> narena_;
+    static std::atomic<long> nchunk_;
+    static std::atomic<long> nalloc_;
+    static std::atomic<long> bytes_;
+
+  public:
+    Arena() : used_(0), size_(0) { }
+    ~Arena() { }
+
+    /// Returns n bytes of memory aligned for any type.
+    void* allocate(size_t n);
+
+    /// The arena that make_pooled uses on this thread (null for the heap).
+    static std::shared_ptr<Arena>& current();
+    /// Enables or disables arenas (they are enabled by default).
+    static void set_enabled(const bool b) { enabled_ = b; }
+    static bool enabled() { return enabled_; }
+
+    /// Returns a summary of the allocations served by arenas.
+    static std::string statistics();
+
+    /// Makes an arena current on this thread during its lifetime.
+    class Scope {
+      protected:
+        std::shared_ptr<Arena> prev_;
+      public:
+        Scope(std::shared_ptr<Arena> a) : prev_(current()) { current() = enabled() ? a : nullptr; }
+        ~Scope() { current() = prev_; }
+    };
+};
+
+
+/// Allocator that draws from an Arena. The arena is kept alive by its allocators, including those stored in shared_ptr control blocks.
+template<typename T>
+class ArenaAllocator {
+  public:
+    using value_type = T;
+    std::shared_ptr<Arena> arena_;
+
+    ArenaAllocator(std::shared_ptr<Arena> a) : arena_(a) { }
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& o) : arena_(o.arena_) { }
+
+    T* allocate(const size_t n) { return static_cast<T*>(arena_->allocate(n*sizeof(T))); }
+    void deallocate(T*, size_t) { }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& o) const { return arena_ == o.arena_; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& o) const { return arena_ != o.arena_; }
+};
+
+
+/// Drop-in replacement of std::make_shared that allocates from the current arena if there is one.
+template<typename T, typename... Args>
+std::shared_ptr<T> make_pooled(Args&&... args) {
+  const std::shared_ptr<Arena>& a = Arena::current();
+  return a ? std::allocate_shared<T>(ArenaAllocator<T>(a), std::forward<Args>(args)...) : std::make_shared<T>(std::forward<Args>(args)...);
+}
+
+}
+
+#endif
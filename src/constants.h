@@ -75,7 +75,8 @@ std::string target_name__(std::string label) {
   return out;
 }
 
-std::string merge__(std::vector<std::string> array, std::string name = "") {
+// if kept, the Gamma tensors are the members computed by the precompute queue (see Forest::hoist_invariants)
+std::string merge__(std::vector<std::string> array, std::string name = "", const bool kept = false) {
   std::stringstream ss;
   std::vector<std::string> done;
   for (auto& label : array) {
@@ -91,7 +92,7 @@ std::string merge__(std::vector<std::string> array, std::string name = "") {
     // some tweaks
     if (label == "f1" || label == "v2" || label == "h1")
       label = label + "_";
-    else if (label != array.front() && label.find("Gamma") != std::string::npos)
+    else if (label != array.front() && label.find("Gamma") != std::string::npos && !kept)
       label = label + "_()";
 
     ss << (label != array.front() ? ", " : "") << ((label == "proj") ? target_name__(name) : label);
@@ -128,11 +129,14 @@ int count_distinct_tensors__(const std::vector<std::string>& labels) {
   return out;
 }
 
+// the theory may also be given on the command line (-D_MRCI etc.), as make bench does
+#if !defined(_CASPT2) && !defined(_MRCI) && !defined(_RELCASPT2) && !defined(_RELMRCI)
 #define _CASPT2
 #define _MULTI_DERIV
 //#define _MRCI
 //#define _RELCASPT2
 //#define _RELMRCI
+#endif
 #if defined(_CASPT2) || defined(_MRCI)
 static const std::string DataType = "double";
 #elif defined(_RELCASPT2) || defined(_RELMRCI)
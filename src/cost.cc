@@ -30,6 +30,8 @@
 using namespace std;
 using namespace smith;
 
+array<double,4> Cost::weights_ = {{1.0, 0.0, 0.0, 0.0}};
+
 string PCost::show() const {
   stringstream out;
   auto j = pcost_.begin();
@@ -51,3 +53,11 @@ string Cost::show() const {
 }
 
 
+string Cost::show_weights() {
+  stringstream out;
+  if (!weighted())
+    out << "FLOPs of the most expensive steps";
+  else
+    out << weights_[0] << " log FLOPs + " << weights_[1] << " log peak intermediate + " << weights_[2] << " log data movement + " << weights_[3] << " log sort traffic";
+  return out.str();
+}
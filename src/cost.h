@@ -26,6 +26,8 @@
 #ifndef _smith_cost_h
 #define _smith_cost_h
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <cassert>
 #include "indexmap.h"
@@ -88,6 +90,18 @@ class Cost {
   protected:
     /// Vector of Pcost.
     std::vector<PCost> cost_;
+    /// Size of the largest intermediate, in elements.
+    double memory_ = 0.0;
+    /// Elements read and written by the contractions.
+    double movement_ = 0.0;
+    /// Elements moved by sort_indices that are not the identity.
+    double sort_ = 0.0;
+
+    /// Weights of log FLOPs, log peak intermediate size, log data movement and log sort traffic when costs are compared.
+    static std::array<double,4> weights_;
+
+    /// Whether anything but FLOPs is weighted.
+    static bool weighted() { return weights_[1] != 0.0 || weights_[2] != 0.0 || weights_[3] != 0.0; }
 
   public:
     /// Make cost from pcost vector.
@@ -96,8 +110,12 @@ class Cost {
     Cost() { }
     ~Cost() { }
 
-    /// return true if total cost is less than other total cost.
+    /// return true if total cost is less than other total cost. Unless memory or data movement are weighted, the most expensive steps are compared in turn.
     bool operator<(const Cost& other) const {
+      if (weighted()) {
+        const double a = score(), b = other.score();
+        if (a != b) return a < b;
+      }
       std::vector<PCost> otherc = other.cost();
       std::vector<PCost> myc = cost();
       for (auto i = myc.begin(), j = otherc.begin(); i != myc.end(); ++i, ++j) {
@@ -108,6 +126,19 @@ class Cost {
       return true;
     }
 
+    /// return true if this cost is not worse than other cost however both are extended by the same contraction steps.
+    bool dominates(const Cost& other) const {
+      if (weighted() && (flops() > other.flops() || memory_ > other.memory_ || movement_ > other.movement_ || sort_ > other.sort_))
+        return false;
+      std::vector<PCost> otherc = other.cost();
+      std::vector<PCost> myc = cost();
+      for (auto i = myc.begin(), j = otherc.begin(); i != myc.end() && j != otherc.end(); ++i, ++j) {
+        if      (*i < *j)      return true;
+        else if (*i > *j)      return false;
+      }
+      return myc.size() <= otherc.size();
+    }
+
     /// return true if total cost is equal to other total cost.
     bool operator==(const Cost& other) const { return cost()==other.cost(); }
     /// return true if total cost is not equal to other total cost.
@@ -120,6 +151,40 @@ class Cost {
 
     /// add to cost_.
     void add_pcost(const PCost& p) { cost_.push_back(p); }
+    /// Adds a contraction step: all of its indices, those of the two inputs and those of the output (the intermediate).
+    void add_step(const PCost& p, const PCost& in0, const PCost& in1, const PCost& out) {
+      cost_.push_back(p);
+      memory_ = std::max(memory_, std::exp(out.pcost_total()));
+      movement_ += std::exp(in0.pcost_total()) + std::exp(in1.pcost_total()) + std::exp(out.pcost_total());
+    }
+
+    /// Adds the elements moved by a sort_indices that is not the identity.
+    void add_sort(const double elements) { sort_ += elements; }
+
+    /// Returns the number of multiply-adds.
+    double flops() const {
+      double out = 0.0;
+      for (auto& i : cost_) out += std::exp(i.pcost_total());
+      return out;
+    }
+    /// Returns the size of the largest intermediate in elements.
+    double memory() const { return memory_; }
+    /// Returns the number of elements read and written.
+    double movement() const { return movement_; }
+    /// Returns the number of elements moved by sort_indices that are not the identity.
+    double sort_traffic() const { return sort_; }
+    /// Returns the weighted sum of the logs of FLOPs, peak intermediate size, data movement and sort traffic.
+    double score() const {
+      return weights_[0] * std::log(std::max(flops(), 1.0)) + weights_[1] * std::log(std::max(memory_, 1.0)) + weights_[2] * std::log(std::max(movement_, 1.0))
+           + weights_[3] * std::log(std::max(sort_, 1.0));
+    }
+
+    /// Sets the weights of FLOPs, memory, data movement and sort traffic (default 1, 0, 0, 0, i.e., FLOPs only).
+    static void set_weights(const double flops, const double memory, const double movement, const double sort = 0.0) { weights_ = {{flops, memory, movement, sort}}; }
+    /// Whether sort traffic is weighted, in which case intermediates are laid out so that few sort_indices are needed.
+    static bool transpose_aware() { return weights_[3] != 0.0; }
+    /// Returns the weights as text.
+    static std::string show_weights();
 //  void add_pcost(int i, int j, int k) { PCost a(i, j, k); cost_.push_back(a); };
 
     /// Show print the cost_ vector.
@@ -30,17 +30,74 @@
 using namespace std;
 using namespace smith;
 
+atomic<long> Diagram::nmutation_(0);
+atomic<long> Diagram::nmutation_pruned_(0);
+atomic<long> Diagram::nbranch_pruned_(0);
+
+namespace {
+
+// Collects (in increasing order) the masks for which the active daggered and undaggered indices balance.
+// Bits are decided from the top; up[k] and down[k] bound what bits below k can still add to the balance.
+void balanced_masks__(const int k, const int mask, const int balance, const vector<int>& sign, const vector<int>& up, const vector<int>& down,
+                      list<int>& out, long& npruned, long& nbranch) {
+  if (k < 0) {
+    out.push_back(mask);
+    return;
+  }
+  for (int b = 0; b != 2; ++b) {
+    const int bal = balance + (b ? sign[k] : 0);
+    if (bal + up[k] < 0 || bal + down[k] > 0) {
+      npruned += 1 << k;
+      ++nbranch;
+      continue;
+    }
+    balanced_masks__(k-1, mask | (b << k), bal, sign, up, down, out, npruned, nbranch);
+  }
+}
+
+}
+
 list<shared_ptr<Diagram>> Diagram::get_all() const {
-  list<shared_ptr<Diagram>> out;
+  // contribution of each general index to (#active dagger - #active no-dagger) when mutated, in the bit order of Operator::mutate_general
+  vector<int> sign;
+  int balance = 0;
+  for (auto& i : op_) {
+    for (auto& j : i->op()) {
+      const shared_ptr<Index>& index = *get<0>(j);
+      const int s = index->dagger() ? 1 : -1;
+      if (index->type() == IndexMap::general)
+        sign.push_back(get<1>(j) == 0 ? s : 0);
+      else if (get<1>(j) == 2)
+        balance += s;
+    }
+  }
+  const int n = sign.size();
+  vector<int> up(n+1), down(n+1);
+  for (int k = 0; k != n; ++k) {
+    up[k+1] = up[k] + max(sign[k], 0);
+    down[k+1] = down[k] + min(sign[k], 0);
+  }
+
+  // only consistent mutations are copied
+  list<int> masks;
+  long npruned = 0, nbranch = 0;
+  if (balance + up[n] >= 0 && balance + down[n] <= 0) {
+    balanced_masks__(n-1, 0, balance, sign, up, down, masks, npruned, nbranch);
+  } else {
+    npruned = 1 << n;
+    ++nbranch;
+  }
+  nmutation_ += 1 << n;
+  nmutation_pruned_ += npruned;
+  nbranch_pruned_ += nbranch;
 
-  const int max = 1 << num_general();
-  for (int i = 0; i != max; ++i) {
+  list<shared_ptr<Diagram>> out;
+  for (auto& i : masks) {
     int j = i;
     shared_ptr<Diagram> d = copy();
     for (auto& k : d->op()) k->mutate_general(j);
-    if (d->consistent_indices()) {
-      out.push_back(d);
-    }
+    assert(d->consistent_indices());
+    out.push_back(d);
   }
   return out;
 }
@@ -52,7 +109,7 @@ shared_ptr<Diagram> Diagram::copy() const {
   map<shared_ptr<Spin>, shared_ptr<Spin>> spinmap;
 
   // creates Diagram without any info
-  shared_ptr<Diagram> out = make_shared<Diagram>();
+  shared_ptr<Diagram> out = make_pooled<Diagram>();
   list<shared_ptr<Operator>> outop;
 
   // loop over operators
@@ -96,7 +153,7 @@ list<shared_ptr<const Index>> Diagram::target_index() const {
     if (i->is_ex()) {
       assert(!found);
       found = true;
-      list<tuple<shared_ptr<Index>*, int, int>> ops = i->op();
+      const OpList& ops = i->op();
       for (auto& j : ops) out.push_back(*get<0>(j));
     }
   }
@@ -258,7 +315,7 @@ bool Diagram::reduce_one_noactive(const int skip) {
     // all possible contraction pattern taken for *j (returned as a list).
     if (cnt + (*j)->num_nodagger() > skip) {
       tuple<double,shared_ptr<Spin>,shared_ptr<Spin>> tmp = (*j)->contract(data, skip-cnt);
-      if ((closed && (*data.first)->label() == "c") || (!closed && (*data.first)->label() == "a")) {
+      if ((closed && (*data.first)->type() == IndexMap::closed()) || (!closed && (*data.first)->type() == IndexMap::virt())) {
         fac_ *= get<0>(tmp);
         newspin = get<1>(tmp);
         oldspin = get<2>(tmp);
@@ -425,4 +482,23 @@ bool Diagram::identical(shared_ptr<Diagram> o) const {
 }
 
 
+string Diagram::key() const {
+  // everything that identical() compares except the spin map of active indices, which need not be one-to-one there.
+  stringstream ss;
+  ss << bra_ << ket_;
+  for (auto& i : op_) {
+    ss << "|" << i->label();
+    for (auto& j : i->op())
+      ss << "," << get<1>(j) << (*get<0>(j))->str(false);
+  }
+  return ss.str();
+}
 
+
+
+string Diagram::statistics() {
+  stringstream ss;
+  ss << "   ***  Pruning  ***" << endl << endl;
+  ss << "  " << nmutation_pruned_ << " of " << nmutation_ << " general-index mutations cut at " << nbranch_pruned_ << " branches before copying" << endl;
+  return ss.str();
+}
@@ -26,6 +26,7 @@
 #ifndef __DIAGRAM_H
 #define __DIAGRAM_H
 
+#include <atomic>
 #include "active.h"
 
 namespace smith {
@@ -55,6 +56,11 @@ class Diagram {
     /// If this Diagram has a daggered counterpart (often the case for residual equations).
     bool dagger_;
 
+    /// Statistics of get_all(): mutations of general indices, those cut before copying, and the branches at which they were cut.
+    static std::atomic<long> nmutation_;
+    static std::atomic<long> nmutation_pruned_;
+    static std::atomic<long> nbranch_pruned_;
+
 
 
   public:
@@ -71,8 +77,10 @@ class Diagram {
     /// Returns a shared_ptr of a diagram that has the same topology as this.
     std::shared_ptr<Diagram> copy() const;
 
-    /// Generate all combination of diagrams (related to general indices).
+    /// Generate all combination of diagrams (related to general indices). Combinations that cannot balance active indices are pruned.
     std::list<std::shared_ptr<Diagram>> get_all() const;
+    /// Returns a summary of the pruning in get_all().
+    static std::string statistics();
 
     // Get functions.
     /// Return the diagram (term) prefactor.
@@ -127,6 +135,8 @@ class Diagram {
     bool permute(const bool proj);
     /// If diagrams are same, based on size, indices, spin, bra and ket.
     bool identical(std::shared_ptr<Diagram> o) const;
+    /// Hash key of the current permutation. Identical diagrams have the same key (spin connectivity is left to identical()).
+    std::string key() const;
 
     /// checks if diagram has target indices from excitation operators, or if ci derivative.
     bool has_target_index() const;
@@ -23,43 +23,110 @@
 //
 
 
+#include <unordered_map>
 #include "equation.h"
+#include "parallel.h"
 #include "constants.h"
+#include "stats.h"
 
 using namespace std;
 using namespace smith;
 
+bool Equation::depth_first_ = false;
+
+namespace {
+
+/// Diagrams obtained from one starting diagram, stored per number of contractions.
+struct Contraction {
+  /// num_dagger() of the first surviving diagram at each level.
+  vector<int> front;
+  /// Fully contracted diagrams at each level.
+  vector<list<shared_ptr<Diagram>>> done;
+};
+
+// depth-first alternative to contract__ that only keeps the diagrams on the current path. Each level is filled in the same order.
+void contract_depth_first__(shared_ptr<Diagram> j, const int level, Contraction& out) {
+  for (int i = 0; i != j->num_dagger(); ++i) {
+    shared_ptr<Diagram> n = j->copy();
+    bool found = n->reduce_one_noactive(i);
+    if (!found) continue;
+    if (n->valid() || n->done()) {
+      if (out.front.size() == level) {
+        out.front.push_back(n->num_dagger());
+        out.done.push_back(list<shared_ptr<Diagram>>());
+      }
+      if (n->done_noactive()) out.done[level].push_back(n);
+      contract_depth_first__(n, level+1, out);
+    }
+  }
+}
+
+
+Contraction contract__(shared_ptr<Diagram> start) {
+  Contraction out;
+  if (Equation::depth_first()) {
+    contract_depth_first__(start, 0, out);
+    return out;
+  }
+
+  list<shared_ptr<Diagram>> current = {start};
+  while (!current.empty()) {
+    list<shared_ptr<Diagram>> next, done;
+    for (auto& j : current) {
+      for (int i = 0; i != j->num_dagger(); ++i) {
+        shared_ptr<Diagram> n = j->copy();
+        bool found = n->reduce_one_noactive(i);
+        if (!found) continue;
+        if (n->valid() || n->done()) {
+          next.push_back(n);
+          if (n->done_noactive()) done.push_back(n);
+        }
+      }
+    }
+    if (!next.empty()) {
+      out.front.push_back(next.front()->num_dagger());
+      out.done.push_back(done);
+    }
+    current = next;
+  }
+  return out;
+}
+
+}
+
 Equation::Equation(shared_ptr<Diagram> in, std::string nam) : name_(nam) {
+  Stats::Phase phase("wick contraction");
 
-  list<shared_ptr<Diagram>> out = in->get_all();
-
-  if (out.size() != 0) {
-    while (out.front()->num_dagger()) {
-      list<shared_ptr<Diagram>> out2;
-      for (auto& j : out) {
-        for (int i = 0; i != j->num_dagger(); ++i) {
-          shared_ptr<Diagram> n = j->copy();
-          bool found = n->reduce_one_noactive(i);
-          if (!found) continue;
-          if (n->valid() || n->done()) {
-            out2.push_back(n);
-            if (n->done_noactive()) {
-              // drop <I|0> terms
+  const list<shared_ptr<Diagram>> start = in->get_all();
+
+  if (start.size() != 0) {
+    // starting diagrams are independent and contracted on the worker threads
+    const vector<shared_ptr<Diagram>> vstart(start.begin(), start.end());
+    vector<Contraction> contracted(vstart.size());
+    parallel_for(vstart.size(), [&](const int n) {
+      // intermediates of each starting diagram are allocated from an arena, which is freed when this constructor returns
+      Arena::Scope scope(make_shared<Arena>());
+      contracted[n] = contract__(vstart[n]);
+    });
+
+    // merged level by level, in the order in which a single breadth-first sweep over all the starting diagrams finds them
+    int front = start.front()->num_dagger();
+    for (int level = 0; front; ++level) {
+      bool any = false;
+      for (auto& c : contracted) {
+        if (level >= c.front.size()) continue;
+        if (!any) front = c.front[level];
+        any = true;
+        for (auto& n : c.done[level]) {
+          // drop <I|0> terms
 #ifndef _MULTI_DERIV
-              if (n->braket().first || n->braket().second) {
-                if (n->gamma_derivative()) diagram_.push_back(n);
-              } else {
-                diagram_.push_back(n);
-              }
-#else
-              diagram_.push_back(n);
+          if ((n->braket().first || n->braket().second) && !n->gamma_derivative()) continue;
 #endif
-            }
-          }
+          // copied out of the arena
+          diagram_.push_back(n->copy());
         }
       }
-      out = out2;
-      if (out.size() == 0) break;
+      if (!any) break;
     }
     // collect target indices from excitation operators.
     for (auto& i : diagram_) i->refresh_indices();
@@ -71,10 +138,10 @@ Equation::Equation(shared_ptr<Diagram> in, std::string nam) : name_(nam) {
     bool four = false;
     for (auto& j : (*it)->op()) {
       if (j->op().size() != 4) continue;
-      four |= all_of(j->op().begin(), j->op().end(), [](const tuple<shared_ptr<Index>*,int,int>& o) { return (*get<0>(o))->label() == "a"; });
+      four |= all_of(j->op().begin(), j->op().end(), [](const tuple<shared_ptr<Index>*,int,int>& o) { return (*get<0>(o))->type() == IndexMap::virt(); });
     }
     for (auto& j : (*it)->op())
-      four &= none_of(j->op().begin(), j->op().end(), [](const tuple<shared_ptr<Index>*,int,int>& o) { return (*get<0>(o))->label() == "x"; });
+      four &= none_of(j->op().begin(), j->op().end(), [](const tuple<shared_ptr<Index>*,int,int>& o) { return (*get<0>(o))->active(); });
 
     if (four)
       it = diagram_.erase(it);
@@ -82,6 +149,7 @@ Equation::Equation(shared_ptr<Diagram> in, std::string nam) : name_(nam) {
       ++it;
   }
 #endif
+  Stats::count("diagrams contracted", diagram_.size());
 }
 
 
@@ -103,7 +171,7 @@ void Equation::term_select(list<string> t) {
       // find excitation operator
       if (j->label().empty()) {
         // compare op index label
-        list<tuple<shared_ptr<Index>*,int, int>> q_ops = j->op();
+        const OpList& q_ops = j->op();
         for (auto& k : q_ops) {
           bool found = false;
           for (auto& term : t)
@@ -127,6 +195,7 @@ void Equation::print() {
 
 // processes active part
 void Equation::active() {
+  Stats::Phase phase("active");
   for (auto& i : diagram_) i->active();
 }
 
@@ -140,11 +209,13 @@ void Equation::refresh_indices() {
 
 // find identical terms
 void Equation::duplicates() {
+  Stats::Phase phase("duplicates");
   duplicates_(false);
   refresh_indices();
   // TODO this is only valid for projection up to doubles
   // For any-order algorithm, we need to use a generic algorithm.
   duplicates_(true);
+  Stats::count("diagrams after duplicates", diagram_.size());
 }
 
 
@@ -166,14 +237,26 @@ void Equation::absorb_ket() {
 
 
 void Equation::duplicates_(const bool proj) {
-  list<list<shared_ptr<Diagram>>::iterator> rm;
+  // diagrams are bucketed by Diagram::key(); candidates are then confirmed by Diagram::identical.
+  vector<list<shared_ptr<Diagram>>::iterator> pos;
+  unordered_map<string, vector<int>> bucket;
   for (auto i = diagram_.begin(); i != diagram_.end(); ++i) {
+    bucket[(*i)->key()].push_back(pos.size());
+    pos.push_back(i);
+  }
+
+  list<list<shared_ptr<Diagram>>::iterator> rm;
+  for (int n = 0; n != pos.size(); ++n) {
+    auto i = pos[n];
     bool found = false;
     // all possible permutations generated here
     do {
-      // find identical
-      auto j = i;
-      for (++j ; j != diagram_.end(); ++j) {
+      // find identical among the later diagrams
+      auto b = bucket.find((*i)->key());
+      if (b == bucket.end()) continue;
+      for (auto& m : b->second) {
+        if (m <= n) continue;
+        auto j = pos[m];
         if ((*i)->identical(*j)) {
           found = true;
           if (!proj) {
@@ -195,6 +278,7 @@ void Equation::duplicates_(const bool proj) {
 
 
 void Equation::simplify() {
+  Stats::Phase phase("simplify");
   list<list<shared_ptr<Diagram>>::iterator> rm;
   for (auto i = diagram_.begin(); i != diagram_.end(); ++i) {
     // find identical
@@ -42,6 +42,9 @@ class Equation {
     /// Name of theory. Generated code for BAGEL will have this name, set in main.cc.
     std::string name_;
 
+    /// If true, contractions are done depth first, which keeps only one branch of partially contracted diagrams in memory.
+    static bool depth_first_;
+
   public:
     /// Construct equation from diagram and name. Contract operators in diagram.
     Equation(std::shared_ptr<Diagram>, std::string nam);
@@ -74,6 +77,11 @@ class Equation {
     /// Refresh indices in each diagram.
     void refresh_indices();
 
+    /// Selects depth-first contraction in the constructor (set by --depth-first).
+    static void set_depth_first(const bool b) { depth_first_ = b; }
+    /// Returns if contraction is depth first.
+    static bool depth_first() { return depth_first_; }
+
     /// Returns the name of this equation.
     std::string name() const { return name_; }
 
@@ -0,0 +1,131 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: estimate.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include "estimate.h"
+#include "constants.h"
+
+using namespace std;
+using namespace smith;
+
+namespace {
+
+mutex mutex__;
+/// Estimates of the tasks generated so far, by task number.
+map<int, Estimate> tasks__;
+
+/// Bytes per element of the generated code.
+double bytes__() { return DataType == "double" ? 8.0 : 16.0; }
+
+/// Returns true if the tensor carries exactly the indices of out.
+bool same_indices__(shared_ptr<const Tensor> t, shared_ptr<const Tensor> out) {
+  return t->index().size() == out->index().size()
+      && all_of(t->index().begin(), t->index().end(), [&out](shared_ptr<const Index> i) {
+           return any_of(out->index().begin(), out->index().end(), [&i](shared_ptr<const Index> j) { return i->same_num(j) && i->same_label(j); }); });
+}
+
+}
+
+
+Estimate::Estimate(const vector<shared_ptr<Tensor>>& tensors) {
+  assert(tensors.size() > 1);
+  shared_ptr<const Tensor> out = tensors.front();
+  const bool sum = all_of(tensors.begin()+1, tensors.end(), [&out](shared_ptr<const Tensor> t) { return same_indices__(t, out); });
+
+  list<shared_ptr<const Index>> all;
+  for (auto t = tensors.begin()+1; t != tensors.end(); ++t) {
+    in_bytes_ += size((*t)->index()) * bytes__();
+    if (sum) flops_ += size((*t)->index());
+    for (auto& i : (*t)->index())
+      if (none_of(all.begin(), all.end(), [&i](shared_ptr<const Index> j) { return i->same_num(j) && i->same_label(j); }))
+        all.push_back(i);
+  }
+  // a multiply and an add for every combination of the indices of a contraction
+  if (!sum) flops_ = 2.0 * size(all);
+
+  out_bytes_ = size(out->index()) * bytes__();
+  if (out->label().compare(0, 1, "I") == 0) intermediate_bytes_ = out_bytes_;
+}
+
+
+Estimate::Estimate(const Tensor& gamma) {
+  const double n = gamma.active()->rdm().size();
+  const double g = size(gamma.index());
+  // with a merged tensor, each RDM term is contracted with it over the merged indices
+  const double m = gamma.merged() ? size(gamma.merged()->index()) : 1.0;
+  flops_ = (gamma.merged() ? 2.0 : 1.0) * n * g * m;
+  in_bytes_ = (n * g * m + (gamma.merged() ? m : 0.0)) * bytes__();
+  out_bytes_ = g * bytes__();
+  intermediate_bytes_ = out_bytes_;
+}
+
+
+double Estimate::size(const list<shared_ptr<const Index>>& index) {
+  double out = 1.0;
+  for (auto& i : index)
+    if (i->type() >= 0) out *= IndexMap::dimension(i->label());
+  return out;
+}
+
+
+string Estimate::members(const int ic) const {
+  {
+    lock_guard<mutex> lock(mutex__);
+    tasks__[ic] = *this;
+  }
+  stringstream ss;
+  ss << setprecision(6);
+  ss << "    static constexpr double estimated_flops = " << flops_ << ";" << endl;
+  ss << "    static constexpr double estimated_in_bytes = " << in_bytes_ << ";" << endl;
+  ss << "    static constexpr double estimated_out_bytes = " << out_bytes_ << ";" << endl;
+  ss << "    static constexpr double estimated_intermediate_bytes = " << intermediate_bytes_ << ";" << endl;
+  return ss.str();
+}
+
+
+void Estimate::write(const string& file) {
+  stringstream ss;
+  ss << setprecision(6);
+  ss << "{" << endl;
+  ss << "  \"dimensions\": {";
+  for (auto& i : IndexMap())
+    ss << (i.second.first ? ", " : "") << "\"" << i.first << "\": " << i.second.second;
+  ss << "}," << endl;
+  ss << "  \"bytes_per_element\": " << bytes__() << "," << endl;
+  ss << "  \"tasks\": [";
+  lock_guard<mutex> lock(mutex__);
+  for (auto i = tasks__.begin(); i != tasks__.end(); ++i)
+    ss << (i == tasks__.begin() ? "" : ",") << endl << "    {\"task\": " << i->first << ", \"flops\": " << i->second.flops() << ", \"in_bytes\": " << i->second.in_bytes()
+       << ", \"out_bytes\": " << i->second.out_bytes() << ", \"intermediate_bytes\": " << i->second.intermediate_bytes() << "}";
+  ss << endl << "  ]" << endl;
+  ss << "}" << endl;
+  ofstream fs(file);
+  if (!fs) throw runtime_error("cannot open " + file);
+  fs << ss.str();
+}
@@ -0,0 +1,70 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: estimate.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __ESTIMATE_H
+#define __ESTIMATE_H
+
+#include "tensor.h"
+
+namespace smith {
+
+/// Estimated FLOPs and traffic of a generated task, in the dimensions of the cost model (see IndexMap::dimension).
+/// They are written into the task class as constexpr members and, for all tasks, into NAME_estimates.json.
+class Estimate {
+  protected:
+    double flops_ = 0.0;
+    /// Bytes read from the input tensors.
+    double in_bytes_ = 0.0;
+    /// Bytes written to the output tensor.
+    double out_bytes_ = 0.0;
+    /// Bytes of the output if it is an intermediate that is kept until it is used.
+    double intermediate_bytes_ = 0.0;
+
+  public:
+    /// Estimate of a task that only resets its target.
+    Estimate() { }
+    /// Estimate of a task that computes tensors[0] from the rest: a sum if they all carry the indices of tensors[0], otherwise a contraction.
+    Estimate(const std::vector<std::shared_ptr<Tensor>>& tensors);
+    /// Estimate of a task that computes a Gamma tensor from its RDMs (and the merged tensor, if any).
+    Estimate(const Tensor& gamma);
+
+    double flops() const { return flops_; }
+    double in_bytes() const { return in_bytes_; }
+    double out_bytes() const { return out_bytes_; }
+    double intermediate_bytes() const { return intermediate_bytes_; }
+
+    /// Number of elements of a tensor with these indices.
+    static double size(const std::list<std::shared_ptr<const Index>>& index);
+
+    /// Records this as the estimate of task ic and returns the constexpr members of its class.
+    std::string members(const int ic) const;
+    /// Writes the recorded estimates as JSON.
+    static void write(const std::string& file);
+};
+
+}
+
+#endif
@@ -23,15 +23,97 @@
 //
 
 
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <set>
 #include <tuple>
 #include "forest.h"
+#include "estimate.h"
 #include "constants.h"
+#include "stats.h"
+#include "parallel.h"
 
 using namespace std;
 using namespace smith;
 
+bool Forest::share_ = true;
+bool Forest::hoist_ = true;
+
+namespace {
+
+/// Appends the indices to the key, numbering them in the order of first appearance so that the key does not depend on their names.
+void index_key__(const list<shared_ptr<const Index>>& index, map<int,int>& num, stringstream& ss) {
+  ss << "(";
+  for (auto& i : index) {
+    const int n = num.emplace(i->num(), num.size()).first->second;
+    ss << i->label() << n << (i->dagger() ? "+" : "") << (i->has_spin() && i->spin()->alpha() ? "*" : "") << ",";
+  }
+  ss << ")";
+}
+
+/// Appends a tensor to the key: its label, factor, scalar and indices, and those of the tensor merged into it.
+void tensor_key__(shared_ptr<const Tensor> t, map<int,int>& num, stringstream& ss) {
+  ss << t->label() << "/" << t->factor() << "/" << t->scalar();
+  index_key__(t->index(), num, ss);
+  if (t->merged()) {
+    ss << "<<" << t->merged()->label();
+    index_key__(t->merged()->index(), num, ss);
+  }
+}
+
+/// Appends the trees that are summed into one intermediate to the key.
+void subtree_key__(const list<shared_ptr<Tree>>& sub, map<int,int>& num, stringstream& ss) {
+  for (auto& t : sub) {
+    ss << "{" << t->dagger();
+    for (auto& o : t->op()) {
+      ss << "+";
+      tensor_key__(o, num, ss);
+    }
+    for (auto& b : t->bc()) {
+      ss << "*";
+      tensor_key__(b->tensor(), num, ss);
+      if (b->subtree().empty()) {
+        tensor_key__(b->source(), num, ss);
+      } else {
+        ss << "[";
+        index_key__(b->subtree().front()->target()->index(), num, ss);
+        subtree_key__(b->subtree(), num, ss);
+        ss << "]";
+      }
+    }
+    ss << "}";
+  }
+}
+
+/// Returns the tensors of the task that computes Gamma i: the Gamma itself, the RDMs and the tensor merged into it.
+vector<string> gamma_tensors__(shared_ptr<Tensor> i) {
+  vector<string> tmp = {i->label()};
+  const bool merged = i->merged() ? true : false;
+  vector<string> rdms = i->active()->required_rdm(merged);
+  for (auto& j : rdms)
+    tmp.push_back(j + (i->der() ? "deriv_" : "_"));
+  if (i->merged()) {
+    // 4RDM derivative is a priori contracted with the fock operator
+    if (!i->der() || !(rdms.size() == 1 && rdms[0] == "rdm4"))
+      tmp.push_back(i->merged()->label() + "_");
+  }
+  return tmp;
+}
+
+/// Returns true if an intermediate below is shared, in which case the tasks of the trees are not numbered as they would be elsewhere.
+bool has_shared__(const list<shared_ptr<Tree>>& sub) {
+  for (auto& t : sub)
+    for (auto& b : t->bc())
+      if (b->shared() || has_shared__(b->subtree())) return true;
+  return false;
+}
+
+}
+
 
 void Forest::filter_gamma() {
+  Stats::Phase phase("gamma filtering");
   shared_ptr<Tree> res;
 
   bool first = true;
@@ -60,33 +142,189 @@ void Forest::filter_gamma() {
     }
     prev = i->gamma();
   }
+  Stats::count("gammas", gamma_.size());
+}
+
 
+void Forest::hoist_invariants() {
+  if (!hoist_) return;
+  Stats::Phase phase("hoisting");
+  int nhoist = 0;
+  double elements = 0.0;
+  for (auto& t : trees_) {
+    if (!t->iterated()) continue;
+    function<void(shared_ptr<Tree>)> walk = [&](shared_ptr<Tree> tr) {
+      for (auto& b : tr->bc()) {
+        if (b->subtree().empty()) continue;
+        // the intermediate is kept only if it is not larger than the tensor it is contracted with (the amplitude)
+        shared_ptr<Tensor> target = b->subtree().front()->target();
+        if ((tr->depth() != 0 || tr->root_targets()) && all_of(b->subtree().begin(), b->subtree().end(), [](shared_ptr<Tree> i) { return i->invariant(); })
+                                                     && Estimate::size(target->index()) <= Estimate::size(b->tensor()->index())) {
+          b->set_hoisted();
+          ++nhoist;
+          elements += Estimate::size(target->index());
+          continue;
+        }
+        for (auto& s : b->subtree()) walk(s);
+      }
+    };
+    walk(t);
+  }
+  Stats::count("intermediates hoisted out of the iterations", nhoist);
+  Stats::count("elements kept by hoisted intermediates", static_cast<long>(elements));
 }
 
 
-OutStream Forest::generate_code() const {
-  OutStream out, tmp;
+void Forest::share_intermediates() {
+  if (!share_) return;
+  Stats::Phase phase("intermediate sharing");
+  // the first binary contraction (in the order of generation) that consumes an intermediate, overall and per tree
+  map<string, shared_ptr<BinaryContraction>> first;
+  vector<map<string, shared_ptr<BinaryContraction>>> first_tree(trees_.size());
+  int nqueue = 0, ncode = 0;
+
+  int n = 0;
+  for (auto& t : trees_) {
+    // CI derivative trees contract Gammas in tasks that do not report to their parents, and are left alone
+    if (t->label().find("deci") != string::npos) {
+      ++n;
+      continue;
+    }
+    function<void(shared_ptr<Tree>)> walk = [&](shared_ptr<Tree> tr) {
+      for (auto& b : tr->bc()) {
+        if (b->subtree().empty()) continue;
+        // top-level binary contractions of trees without root targets have no task of their own
+        if (tr->depth() != 0 || tr->root_targets()) {
+          shared_ptr<Tensor> target = b->subtree().front()->target();
+          map<int,int> num;
+          stringstream ss;
+          ss << setprecision(17) << b->nogamma_upstream();
+          index_key__(target->index(), num, ss);
+          subtree_key__(b->subtree(), num, ss);
+          const string key = ss.str();
+
+          auto iter = first_tree[n].find(key);
+          if (iter != first_tree[n].end()) {
+            // an intermediate that is kept across the iterations cannot take the name of one that is local to the precompute queue
+            if (!b->hoisted() || iter->second->hoisted()) {
+              b->set_shared(iter->second, true);
+              target->set_alias(iter->second->subtree().front()->target());
+              ++nqueue;
+              continue;
+            }
+          } else {
+            first_tree[n].emplace(key, b);
+            auto jter = first.find(key);
+            if (jter != first.end() && !has_shared__(jter->second->subtree())) {
+              b->set_shared(jter->second, false);
+              ++ncode;
+              continue;
+            }
+            first.emplace(key, b);
+          }
+        }
+        for (auto& s : b->subtree()) walk(s);
+      }
+    };
+    walk(t);
+    ++n;
+  }
+  Stats::count("intermediates shared in a queue", nqueue);
+  Stats::count("intermediates sharing task classes", ncode);
+}
+
+
+vector<string> Forest::queues() const {
+  vector<string> out;
+  for (auto& i : trees_) out.push_back(i->label());
+  if (precompute()) out.push_back("precompute");
+  return out;
+}
+
+
+bool Forest::precompute() const {
+  return hoist_ && any_of(trees_.begin(), trees_.end(), [](shared_ptr<Tree> i) { return i->iterated(); });
+}
+
+
+list<shared_ptr<Tensor>> Forest::kept_gamma() const {
+  list<shared_ptr<Tensor>> out;
+  if (!precompute()) return out;
+  set<string> labels;
+  for (auto& t : trees_)
+    if (t->iterated())
+      for (auto& g : t->gather_gamma()) labels.insert(g->label());
+  for (auto& i : gamma_)
+    if (!i->der() && labels.count(i->label())) out.push_back(i);
+  return out;
+}
+
+
+void Forest::generate_code(OutStream& out) const {
   string depends, tasks, specials;
 
-  out << generate_headers();
-  out << generate_gammas();
+  {
+    Stats::Phase phase("generate headers");
+    out << generate_headers();
+  }
+  {
+    Stats::Phase phase("generate gammas");
+    out << generate_gammas();
+  }
 
-  for (auto& i : trees_) {
-    out.ss << "    std::shared_ptr<Queue> make_" << i->label() << "q(const bool reset = true, const bool diagonal = true);" << endl;
+  // task numbers and intermediates are assigned in a first pass, so that the trees can be generated concurrently
+  const vector<shared_ptr<Tree>> trees(trees_.begin(), trees_.end());
+  vector<int> start(trees.size()), zero(trees.size());
+  vector<vector<shared_ptr<Tensor>>> known(trees.size());
+  for (int n = 0; n != trees.size(); ++n) {
+    start[n] = icnt;
+    zero[n] = i0;
+    known[n] = itensors_;
+    icnt = trees[n]->count_tasks(icnt, itensors_);
+    if (trees[n]->depth() == 0 && trees[n]->root_targets()) i0 = start[n];
+  }
+
+  // trees are generated in batches of one per thread, and each batch is appended before the next one is started
+  const int nbatch = max(1, num_threads());
+  for (int b = 0; b < trees.size(); b += nbatch) {
+    vector<OutStream> task_list(min<int>(nbatch, trees.size() - b));
+    {
+      Stats::Phase phase("generate tasks");
+      parallel_for(task_list.size(), [&](const int k) {
+        const int n = b + k;
+        int tcnt, t0;
+        vector<shared_ptr<Tensor>> itensors;
+        tie(task_list[k], tcnt, t0, itensors) = trees[n]->generate_task_list(start[n], zero[n], gamma_, known[n]);
+        if (tcnt != (n+1 != trees.size() ? start[n+1] : icnt) || itensors.size() != (n+1 != trees.size() ? known[n+1] : itensors_).size())
+          throw logic_error("Tree::count_tasks does not agree with Tree::generate_task_list");
+      });
+    }
 
-    out.ee << "shared_ptr<Queue> " << forest_name_ << "::" << forest_name_ << "::make_" << i->label() << "q(const bool reset, const bool diagonal) {" << endl << endl;
-    out.ee << "  array<shared_ptr<const IndexRange>,3> pindex = {{rclosed_, ractive_, rvirt_}};" << endl;
+    for (int k = 0; k != task_list.size(); ++k) {
+      shared_ptr<Tree> i = trees[b + k];
+      out.ee.mark(b + k);
+      out.ss << "    std::shared_ptr<Queue> make_" << i->label() << "q(const bool reset = true, const bool diagonal = true);" << endl;
 
-    tie(tmp, icnt, i0, itensors_) = i->generate_task_list(icnt, i0, gamma_, itensors_);
+      out.ee << "shared_ptr<Queue> " << forest_name_ << "::" << forest_name_ << "::make_" << i->label() << "q(const bool reset, const bool diagonal) {" << endl << endl;
+      out.ee << "  array<shared_ptr<const IndexRange>,3> pindex = {{rclosed_, ractive_, rvirt_}};" << endl;
 
-    out << tmp;
-    out.ee << "  return " << i->label() << "q;" << endl;
-    out.ee << "}" << endl << endl;
+      out << move(task_list[k]);
+      out.ee << "  return " << i->label() << "q;" << endl;
+      out.ee << "}" << endl << endl;
+    }
   }
 
-  out << generate_algorithm();
+  if (precompute()) {
+    Stats::Phase phase("generate precompute");
+    out << generate_precompute(trees.size(), move(out.pp));
+  }
 
-  return out;
+  {
+    Stats::Phase phase("generate algorithm");
+    out << generate_algorithm();
+  }
+  Stats::count("tasks", icnt);
+  Stats::count("intermediates", itensors_.size());
 }
 
 
@@ -99,12 +337,15 @@ OutStream Forest::generate_headers() const {
   icnt = 0;
   i0 = icnt;
 
+  // banners and includes are tagged so that shards can replace them with their own
+  for (auto i : {&out.ss, &out.tt, &out.cc, &out.dd, &out.ee, &out.gg}) i->mark(Banner);
   out.ss << header(forest_name_ + ".h");
   out.tt << header(forest_name_ + "_tasks.h");
   out.cc << header(forest_name_ + "_gen.cc");
   out.dd << header(forest_name_ + "_tasks.cc");
   out.ee << header(forest_name_ + ".cc");
   out.gg << header(forest_name_ + "_gamma.cc");
+  for (auto i : {&out.ss, &out.tt, &out.cc, &out.dd, &out.ee, &out.gg}) i->mark(Prologue);
 
   out.ss << "#ifndef __SRC_SMITH_" << forest_name_ << "_H" << endl;
   out.ss << "#define __SRC_SMITH_" << forest_name_ << "_H" << endl;
@@ -222,30 +463,7 @@ OutStream Forest::generate_gammas() const {
     bool use_blas = false;
     out << i->generate_gamma(icnt, use_blas, i->der());
 
-    vector<string> tmp = {i->label()};
-    const bool merged = i->merged() ? true : false;
-    vector<string> rdms = i->active()->required_rdm(merged);
-    if (i->der()) { // derivative rdm
-      for (auto& j : rdms) {
-        stringstream zz;
-        zz << j << "deriv_";
-        tmp.push_back(zz.str());
-      }
-    } else {  // normal rdms
-      for (auto& j : rdms) {
-        stringstream zz;
-        zz << j << "_";
-        tmp.push_back(zz.str());
-      }
-    }
-    if (i->merged()) {
-      // 4RDM derivative is a priori contracted with the fock operator
-      if (!i->der() || !(rdms.size() == 1 && rdms[0] == "rdm4")) {
-        stringstream mm;
-        mm << i->merged()->label() << "_";
-        tmp.push_back(mm.str());
-      }
-    }
+    vector<string> tmp = gamma_tensors__(i);
     // virtual generate_task
     if (i->der()) {
       out << trees_.front()->generate_task(0, icnt, tmp, "", 0, true);
@@ -262,11 +480,43 @@ OutStream Forest::generate_gammas() const {
 }
 
 
+OutStream Forest::generate_precompute(const int tag, Rope&& pp) const {
+  OutStream out;
+  out.ee.mark(tag);
+  const list<shared_ptr<Tensor>> gamma = kept_gamma();
+  for (auto& i : gamma)
+    out.ss << "    std::shared_ptr<Tensor> " << i->label() << ";" << endl;
+  out.ss << "    std::shared_ptr<Queue> make_precomputeq(const bool diagonal = true);" << endl;
+
+  out.ee << "shared_ptr<Queue> " << forest_name_ << "::" << forest_name_ << "::make_precomputeq(const bool diagonal) {" << endl << endl;
+  out.ee << "  array<shared_ptr<const IndexRange>,3> pindex = {{rclosed_, ractive_, rvirt_}};" << endl;
+  out.ee << "  auto precomputeq = make_shared<Queue>();" << endl;
+  // the Gamma tensors are kept in members, using the task classes of the Gamma functions
+  for (auto& i : gamma) {
+    const vector<string> tmp = gamma_tensors__(i);
+    out.ee << i->constructor_str(/*diagonal*/false, /*member*/true) << endl;
+    out.ee << "  auto tensor" << i->num() << " = vector<shared_ptr<Tensor>>{";
+    for (auto j = tmp.begin(); j != tmp.end(); ++j)
+      out.ee << (j != tmp.begin() ? ", " : "") << *j;
+    out.ee << "};" << endl;
+    out.ee << "  auto task" << i->num() << " = make_shared<Task" << i->num() << ">(tensor" << i->num() << ", pindex);" << endl;
+    out.ee << "  precomputeq->add_task(task" << i->num() << ");" << endl << endl;
+  }
+  // followed by the hoisted intermediates that were set aside while the trees were generated
+  out.ee.splice(move(pp));
+  out.ee << "  return precomputeq;" << endl;
+  out.ee << "}" << endl << endl;
+  Stats::count("gammas kept by the precompute queue", gamma.size());
+  return out;
+}
+
+
 OutStream Forest::generate_algorithm() const {
   OutStream out;
   string indent = "      ";
 
   // generate computational algorithm
+  out.ee.mark(Body);
   out.ss << endl;
   out.ss << "  public:" << endl;
   out.ss << "    " << forest_name_ << "(std::shared_ptr<const SMITH_Info<" << DataType << ">> ref);" << endl;
@@ -311,7 +561,7 @@ OutStream Forest::generate_algorithm() const {
   out.ee << "void " << forest_name_ << "::" << forest_name_ << "::solve() {" << endl;
 
   if (forest_name_ == "CASPT2" || forest_name_ == "RelCASPT2")
-    out.ee << caspt2_main_driver_();
+    out.ee << caspt2_main_driver_(precompute());
   else if (forest_name_ == "MRCI" || forest_name_ == "RelMRCI")
     out.ee << msmrci_main_driver_();
 
@@ -383,6 +633,7 @@ OutStream Forest::generate_algorithm() const {
 
   out.ss << "#endif" << endl << endl;
 
+  out.tt.mark(Epilogue);
   out.tt << endl;
   out.tt << "}" << endl;
   out.tt << "}" << endl;
@@ -393,7 +644,7 @@ OutStream Forest::generate_algorithm() const {
 }
 
 
-string Forest::caspt2_main_driver_() {
+string Forest::caspt2_main_driver_(const bool precompute) {
   stringstream ss;
 
   ss << "  Timer timer;" << endl;
@@ -403,6 +654,12 @@ string Forest::caspt2_main_driver_() {
   ss << "  while (!sourceq->done())" << endl;
   ss << "    sourceq->next_compute();" << endl;
 
+  if (precompute) {
+    ss << "  shared_ptr<Queue> precomputeq = make_precomputeq();" << endl;
+    ss << "  while (!precomputeq->done())" << endl;
+    ss << "    precomputeq->next_compute();" << endl;
+  }
+
   ss << "  Timer mtimer;" << endl;
   ss << "  int iter = 0;" << endl;
   ss << "  for ( ; iter != info_->maxiter(); ++iter) {" << endl;
@@ -55,8 +55,14 @@ class Forest {
     /// Intermediate tensors
     mutable std::vector<std::shared_ptr<Tensor>> itensors_;
 
-    /// Returns the main body of the CASPT2 driver
-    static std::string caspt2_main_driver_();
+    /// If false, share_intermediates() does nothing.
+    static bool share_;
+    /// If false, there is no precompute queue: the iterated trees compute their Gamma tensors in every iteration, hoist_invariants() does nothing,
+    /// and their orderings are chosen as for the others.
+    static bool hoist_;
+
+    /// Returns the main body of the CASPT2 driver, which runs the precompute queue before the iterations if there is one
+    static std::string caspt2_main_driver_(const bool precompute);
     /// Returns the main body of the MS-MRCI driver
     static std::string msmrci_main_driver_();
 
@@ -65,8 +71,26 @@ class Forest {
 
     /// Function runs from top level (main.cc) adds unique gamma to gamma_ list.
     void filter_gamma();
+    /// Finds intermediates that are computed more than once, up to the names of indices, in all the trees. Within a queue they are computed once
+    /// and all the consumers depend on the tasks that compute them; between queues the task classes are generated once. Runs after filter_gamma().
+    void share_intermediates();
+    /// Turns share_intermediates() on or off (off with --no-share).
+    static void set_share(const bool b) { share_ = b; }
+    /// Finds intermediates of the trees computed in every iteration (Tree::iterated) into which no amplitude enters. They are computed once by a
+    /// precompute queue before the iterations, into members of the method that are kept. Runs before share_intermediates().
+    void hoist_invariants();
+    /// Turns hoist_invariants() on or off (off with --no-hoist).
+    static void set_hoist(const bool b) { hoist_ = b; }
+    static bool hoist() { return hoist_; }
+
     /// Returns the unique Gamma tensors.
     std::list<std::shared_ptr<Tensor>> gamma() const { return gamma_; }
+    /// Returns true if a precompute queue is generated, i.e., if hoisting is on and there is an iterated tree.
+    bool precompute() const;
+    /// Returns the Gamma tensors of the iterated trees, which the precompute queue computes once into members.
+    std::list<std::shared_ptr<Tensor>> kept_gamma() const;
+    /// Returns the labels of the trees, which name their queues.
+    std::vector<std::string> queues() const;
 
     /// Returns name of generated code.
     std::string name() const { return forest_name_; }
@@ -75,11 +99,15 @@ class Forest {
 
     // code generation //
     /// Driver for code generation goes through trees and generates task and task list files.
-    OutStream generate_code() const;
+    OutStream generate_code() const { OutStream out; generate_code(out); return out; }
+    /// Appends the generated code to out as it is generated, so that it can be streamed to files.
+    void generate_code(OutStream& out) const;
     /// Generates headers and residual target task.
     OutStream generate_headers() const;
     /// Generates code for all unique gamma.
     OutStream generate_gammas() const;
+    /// Generates the precompute queue from the kept Gamma tensors and pp, the code of the hoisted intermediates. Its code is tagged with tag.
+    OutStream generate_precompute(const int tag, Rope&& pp) const;
     /// Generates the algorithm to be used in BAGEL.
     OutStream generate_algorithm() const;
 
@@ -32,6 +32,8 @@
 #include <list>
 #include <iostream>
 #include <cassert>
+#include "indexmap.h"
+#include "arena.h"
 
 namespace smith {
 
@@ -67,8 +69,8 @@ class Spin {
 /// A class for tensor indices. Can refer to orbital attributes: Index defined by label (space), spin, electron number and if is transposed (daggered). Also can refer to cI index.
 class Index_Core {
   protected:
-    /// Index label, related to closed, active, or virtual (c, x, and a, respectively).
-    std::string label_;
+    /// Index class ID (see IndexMap), related to closed, active, or virtual (c, x, and a, respectively).
+    int type_;
     /// Index number (if orbital index, electron).
     int num_;
     /// If transposed, ie daggered. Important in Wick's theorem and equations.
@@ -76,13 +78,13 @@ class Index_Core {
 
   public:
     /// Make index object from label and dagger info. Initialize label, number(0), dagger.
-    Index_Core(std::string lab, bool dag) : label_(lab), num_(0), dagger_(dag) {}
+    Index_Core(std::string lab, bool dag) : type_(IndexMap::id(lab)), num_(0), dagger_(dag) {}
     /// Make a copy of the index
-    Index_Core(const Index_Core& o) : label_(o.label_), num_(o.num_), dagger_(o.dagger_) { }
+    Index_Core(const Index_Core& o) : type_(o.type_), num_(o.num_), dagger_(o.dagger_) { }
     /// Make copy of the index but with reversed dagger info
-    Index_Core(const Index_Core& o, bool b) : label_(o.label_), num_(o.num_), dagger_(!b) { }
+    Index_Core(const Index_Core& o, bool b) : type_(o.type_), num_(o.num_), dagger_(!b) { }
     /// Make copy of index but with altered number
-    Index_Core(const Index_Core& o, int i) : label_(o.label_), num_(i), dagger_(o.dagger_) { }
+    Index_Core(const Index_Core& o, int i) : type_(o.type_), num_(i), dagger_(o.dagger_) { }
 
     /// Return index number.
     int num() const { return num_; }
@@ -91,9 +93,11 @@ class Index_Core {
     /// Set index number.
     void set_num(const int i) { num_ = i; }
     /// Return index label (orbital type).
-    const std::string label() const { return label_; }
+    const std::string& label() const { return IndexMap::label(type_); }
+    /// Return index class ID.
+    int type() const { return type_; }
     /// Set index type, default is a (virtual).
-    void set_label(const std::string& a) { label_ = a; }
+    void set_type(const int a) { type_ = a; }
 };
 
 class Index {
@@ -106,12 +110,12 @@ class Index {
 
   public:
     /// Make index object from label and dagger info. Initialize label, number(0), dagger.
-    Index(std::string lab, bool dag) { core_ = std::make_shared<Index_Core>(lab, dag); }
-    Index(const Index& o) : spin_(o.spin_) { core_ = std::make_shared<Index_Core>(*o.core_); }
+    Index(std::string lab, bool dag) { core_ = make_pooled<Index_Core>(lab, dag); }
+    Index(const Index& o) : spin_(o.spin_) { core_ = make_pooled<Index_Core>(*o.core_); }
     /// Make copy of the index but with reversed dagger info
-    Index(const Index& o, bool b) : spin_(o.spin_) { core_ = std::make_shared<Index_Core>(*o.core_, b); }
+    Index(const Index& o, bool b) : spin_(o.spin_) { core_ = make_pooled<Index_Core>(*o.core_, b); }
     /// Make copy of index but with altered number
-    Index(const Index& o, int i) : spin_(o.spin_) { core_ = std::make_shared<Index_Core>(*o.core_, i); }
+    Index(const Index& o, int i) : spin_(o.spin_) { core_ = make_pooled<Index_Core>(*o.core_, i); }
     Index(std::shared_ptr<Index_Core> c) : core_(c) { }
     ~Index() { }
 
@@ -122,17 +126,19 @@ class Index {
     /// Set index number.
     void set_num(const int i) { core_->set_num(i); }
     /// Return index label (orbital type).
-    std::string label() const { return core_->label(); }
-    /// Set index type, default is a (virtual).
-    void set_label(const std::string& a) { core_->set_label(a); }
+    const std::string& label() const { return core_->label(); }
+    /// Return index class ID.
+    int type() const { return core_->type(); }
+    /// Set index class ID.
+    void set_type(const int a) { core_->set_type(a); }
 
     /// If active.  Checks label if active (x).
-    bool active() const { return label() == "x"; }
+    bool active() const { return type() == IndexMap::active(); }
 
     /// Returns true if index number is same for both indices.
     bool same_num(const std::shared_ptr<const Index>& o) const { return o->num() == num(); }
     /// Returns true if label is same for both indices.
-    bool same_label(const std::shared_ptr<const Index>& o) const { return o->label() == label(); }
+    bool same_label(const std::shared_ptr<const Index>& o) const { return o->type() == type(); }
 
     /// Returns string with index label_, and if argument is true: dagger info (nothing or if daggered, +) and spin info.
     std::string str(const bool opr = true) const {
@@ -158,28 +164,30 @@ class Index {
     std::shared_ptr<Spin> spin() { assert(spin_); return spin_; }
     /// Returns const spin.
     const std::shared_ptr<Spin> spin() const { assert(spin_); return spin_; }
+    /// Returns true if spin has been set.
+    bool has_spin() const { return !!spin_; }
 
     /// Returns true if spin is same for both indices.
     bool same_spin(const std::shared_ptr<const Index>& o) const { return o->spin() == spin(); }
 
     /// Clone Index with label_, num_ and dagger_ info. Note that this does not set spin.
     std::shared_ptr<Index> clone() const {
-      return std::make_shared<Index>(core_);
+      return make_pooled<Index>(core_);
     }
 
     /// Check if indices are equal by comparing num() and label(). Be careful that this does not check dagger! Should not check, actually.
     bool identical(std::shared_ptr<const Index> o) const {
-      return num() == o->num() && label() == o->label() && ((!spin_ && !o->spin_) || (spin()->alpha() == o->spin()->alpha()));
+      return num() == o->num() && type() == o->type() && ((!spin_ && !o->spin_) || (spin()->alpha() == o->spin()->alpha()));
     }
 
     /// Gives orbital space name (closed_, virt_, active_) based on index label_.
     std::string generate() const {
       std::string out;
-      if (label() == "c") {
+      if (type() == IndexMap::closed()) {
         out = "closed_";
-      } else if (label() == "a") {
+      } else if (type() == IndexMap::virt()) {
         out = "virt_";
-      } else if (label() == "x") {
+      } else if (type() == IndexMap::active()) {
         out = "active_";
       } else if (label() == "ci") {
         out = "ci_";
@@ -189,21 +197,13 @@ class Index {
       return out;
     }
 
-    /// Gives index range name ([0], [1], [2] for closed, active, virtual orbital spaces, respectively and [3] for ci range) based on index label.
+    /// Gives index range name ([0], [1], [2] for closed, active, virtual orbital spaces, respectively and [3] for ci range) based on index class ID.
     std::string generate_range(const std::string postfix = "") const {
-      std::string out = "range" + postfix;
-      if (label() == "c") {
-        out += "[0]";
-      } else if (label() == "x") {
-        out += "[1]";
-      } else if (label() == "a") {
-        out += "[2]";
-      } else if (label() == "ci") {
-        out += "[3]";
-      } else {
+      if (type() == IndexMap::general)
         throw std::runtime_error("unkonwn index type in Index::generate_range()");
-      }
-      return out;
+      std::stringstream ss;
+      ss << "range" << postfix << "[" << type() << "]";
+      return ss.str();
     }
 
 };
@@ -28,6 +28,9 @@
 
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
 #include <vector>
 #include <memory>
 #include <list>
@@ -47,10 +50,10 @@ class IndexMap {
   public:
     /// Construct index classes.
     IndexMap() {
-      map_.push_back(std::make_pair("c", std::make_pair(0, 28)));
-      map_.push_back(std::make_pair("x", std::make_pair(1, 6)));
-      map_.push_back(std::make_pair("a", std::make_pair(2, 232)));
-      map_.push_back(std::make_pair("ci", std::make_pair(3, 2000)));
+      map_.push_back(std::make_pair("c", std::make_pair(0, dimension("c"))));
+      map_.push_back(std::make_pair("x", std::make_pair(1, dimension("x"))));
+      map_.push_back(std::make_pair("a", std::make_pair(2, dimension("a"))));
+      map_.push_back(std::make_pair("ci", std::make_pair(3, dimension("ci"))));
     }
     ~IndexMap() { }
     /// Returns map_ size.
@@ -65,10 +68,72 @@ class IndexMap {
       if (iter == map_.end()) throw std::runtime_error("key is no valid in Index::type()");
       return iter->second.first;
     }
+    /// Class ID of general indices ("g"). These are not an orbital class and are mutated before contraction.
+    static const int general = -1;
+    /// Returns the class ID of a label, which is the type above (or general). Indices store this ID instead of the label.
+    static int id(const std::string& label) { return label == "g" ? general : instance().type(label); }
+    /// Returns the label of a class ID. Only needed when code is generated.
+    static const std::string& label(const int id) {
+      static const std::string g = "g";
+      if (id == general) return g;
+      for (auto& i : instance())
+        if (i.second.first == id) return i.first;
+      throw std::runtime_error("unknown class ID in IndexMap::label()");
+    }
+    /// Class ID of closed orbitals.
+    static int closed() { static const int c = id("c"); return c; }
+    /// Class ID of active orbitals.
+    static int active() { static const int x = id("x"); return x; }
+    /// Class ID of virtual orbitals.
+    static int virt() { static const int a = id("a"); return a; }
+
     /// Returns index class beginning iterator.
     std::list<std::pair<std::string, std::pair<int,int>> >::const_iterator begin() const { return map_.begin(); }
     /// Returns index class end iterator.
     std::list<std::pair<std::string, std::pair<int,int>> >::const_iterator end() const { return map_.end(); }
+
+    /// Returns the dimension of an index class that is used in the cost model.
+    static int dimension(const std::string& label) {
+      auto iter = dimensions().find(label);
+      if (iter == dimensions().end()) throw std::runtime_error("unknown index class " + label + " in IndexMap::dimension()");
+      return iter->second;
+    }
+    /// Sets the dimension of an index class. Has to be called before any cost is computed.
+    static void set_dimension(const std::string& label, const int n) {
+      if (n <= 0) throw std::runtime_error("dimension of index class " + label + " has to be positive");
+      dimension(label);
+      dimensions()[label] = n;
+    }
+    /// Reads dimensions from a file with a label and a dimension per line, e.g., "a 600". Text after # is ignored.
+    static void read_dimensions(const std::string& file) {
+      std::ifstream fs(file);
+      if (!fs) throw std::runtime_error("cannot open " + file);
+      std::string line;
+      while (std::getline(fs, line)) {
+        std::stringstream ss(line.substr(0, line.find('#')));
+        std::string label;
+        int n;
+        if (!(ss >> label)) continue;
+        if (!(ss >> n)) throw std::runtime_error("invalid line in " + file + ": " + line);
+        set_dimension(label, n);
+      }
+    }
+    /// Returns the dimensions as text, e.g., "c 28, x 6, a 232, ci 2000".
+    static std::string show_dimensions() {
+      std::stringstream ss;
+      for (auto& i : IndexMap())
+        ss << (i.second.first ? ", " : "") << i.first << " " << i.second.second;
+      return ss.str();
+    }
+
+  private:
+    /// Dimensions of the index classes; the defaults are those of a medium-sized molecule.
+    static std::map<std::string,int>& dimensions() {
+      static std::map<std::string,int> d = {{"c", 28}, {"x", 6}, {"a", 232}, {"ci", 2000}};
+      return d;
+    }
+    /// The index classes used for the class IDs.
+    static const IndexMap& instance() { static const IndexMap map; return map; }
 };
 
 }
@@ -25,11 +25,316 @@
 
 #include <iomanip>
 #include <algorithm>
+#include <map>
+#include <mutex>
+#include "constants.h"
 #include "listtensor.h"
+#include "stats.h"
 
 using namespace std;
 using namespace smith;
 
+bool ListTensor::report_ = false;
+bool ListTensor::factorize_ = true;
+
+namespace {
+
+mutex orderings_mutex__;
+/// Chosen orderings and how many diagrams share them.
+map<string, int> orderings__;
+
+/// Numbers of indices of each class.
+PCost count__(const list<shared_ptr<const Index>>& index) {
+  vector<int> cost(4);
+  for (auto& a : index) {
+    if (a->type() >= 0 && a->type() < cost.size()) cost[a->type()] += 1;
+    else {
+      stringstream ss; ss << "this should not happen - ListTensor::calculate_cost " << a->label() << endl;
+      throw logic_error(ss.str());
+    }
+  }
+  return PCost(cost);
+}
+
+/// Contracts a tensor with the intermediate current, adds the step to cost and returns the indices of the new intermediate.
+list<shared_ptr<const Index>> contract__(list<shared_ptr<const Index>> current, const list<shared_ptr<const Index>>& index, Cost& cost) {
+  const PCost in0 = count__(current);
+  list<shared_ptr<const Index>> sumindex, outindex;
+  for (auto& a : current)
+    for (auto& b : index)
+      if (a->same_num(b) && a->same_label(b))
+        sumindex.push_back(a);
+
+  current.insert(current.end(), index.begin(), index.end());
+  for (auto& a : current) {
+    bool check = false;
+    for (auto& b : sumindex)
+      if (a->same_num(b) && a->same_label(b))
+        check = true;
+    if (!check)
+      outindex.push_back(a);
+  }
+
+  sumindex.insert(sumindex.end(), outindex.begin(), outindex.end());
+  cost.add_step(count__(sumindex), in0, count__(index), count__(outindex));
+  return outindex;
+}
+
+/// Indices of the intermediate made from tensors, in order of appearance (see ListTensor::target()).
+list<shared_ptr<const Index>> target_index__(const list<shared_ptr<Tensor>>& tensors) {
+  list<shared_ptr<const Index>> ind;
+  for (auto t = tensors.begin(); t != tensors.end(); ++t) {
+    list<shared_ptr<const Index>> index = (*t)->index();
+    for (auto j = index.begin(); j != index.end(); ++j) {
+      bool found = false;
+      list<shared_ptr<const Index>>::iterator remove;
+      for (auto i = ind.begin(); i != ind.end(); ++i) {
+        if ((*i)->num() == (*j)->num()) {
+          if ((*j)->label() == "ci") break;   // todo is there a better way?
+          found = true;
+          remove = i;
+          break;
+        }
+      }
+      if (found) {
+        ind.erase(remove);
+      } else {
+        ind.push_back(*j);
+      }
+    }
+  }
+  return ind;
+}
+
+bool identity__(const vector<int>& map) {
+  for (int i = 0; i != map.size(); ++i)
+    if (map[i] != i) return false;
+  return true;
+}
+
+/// An ordering of some of the tensors (front first, contracted from the back) and its cost.
+struct Ordering {
+  Cost cost;
+  vector<int> order;
+  /// Index order of the dgemm result of the front tensor (when sort traffic is weighted).
+  list<shared_ptr<const Index>> natural;
+};
+
+/// Returns true if a is not worse than b after any further steps (and comes later in permutation order if they are equal).
+bool better__(const Ordering& a, const Ordering& b) {
+  if (!a.cost.dominates(b.cost) || a.natural != b.natural) return false;
+  return !b.cost.dominates(a.cost) || a.order > b.order;
+}
+
+/// Adds an ordering of a subset unless another one is better, and removes those it is better than.
+void add_ordering__(vector<Ordering>& orderings, Ordering&& o) {
+  for (auto& i : orderings)
+    if (better__(i, o)) return;
+  orderings.erase(remove_if(orderings.begin(), orderings.end(), [&o](const Ordering& i) { return better__(o, i); }), orderings.end());
+  orderings.push_back(move(o));
+}
+
+double size__(const list<shared_ptr<const Index>>& index) { return exp(count__(index).pcost_total()); }
+
+/// The tensors of a diagram and the best orderings of each subset of them (bit i is tensors[i]).
+struct Chain {
+  vector<shared_ptr<Tensor>> tensors;
+  /// Indices of the intermediate left by contracting each subset.
+  vector<list<shared_ptr<const Index>>> inter;
+  /// When sort traffic is weighted, the intermediates are laid out as in Tree (see Tensor::gemm_index and Tensor::move_to_back).
+  vector<list<shared_ptr<const Index>>> targets;
+  /// Orderings of each subset that no other ordering of it is better than.
+  vector<vector<Ordering>> best;
+  /// FLOPs of the cheapest ordering of each subset.
+  vector<double> flops;
+  /// Amplitudes among the tensors and the largest of them, if steps without them are hoisted out of the iterations.
+  int amplitudes = 0;
+  double hoist = 0.0;
+
+  Chain(const list<shared_ptr<Tensor>>& l, const bool h);
+
+  int all() const { return (1 << tensors.size()) - 1; }
+  /// Puts tensor i in front of the ordering r of the other tensors of s.
+  Ordering extend(const int s, const int i, const Ordering& r) const;
+  /// The cheapest ordering of s; among equal ones the last in permutation order is taken.
+  const Ordering& pick(const int s) const;
+  /// Whether the intermediate of s is computed once (see Forest::hoist_invariants): it has no amplitudes and is not larger than they are.
+  bool once(const int s) const { return amplitudes && !(s & amplitudes) && size__(inter[s]) <= hoist; }
+  /// FLOPs of contracting tensor i with the intermediate of the other tensors of s in every iteration.
+  double step(const int s, const int i) const {
+    Cost cost;
+    contract__(inter[s ^ (1 << i)], tensors[i]->index(), cost);
+    return once(s) ? 0.0 : cost.flops();
+  }
+};
+
+Chain::Chain(const list<shared_ptr<Tensor>>& l, const bool h) : tensors(l.begin(), l.end()) {
+  // I need to sort the tensors first
+  sort(tensors.begin(), tensors.end(), Tensor::comp);
+  const int n = tensors.size();
+  if (n > 16) throw logic_error("too many tensors in a diagram - ListTensor::reorder");
+  for (int i = 0; i != n && h; ++i)
+    if (tensors[i]->amplitude()) {
+      amplitudes |= 1 << i;
+      hoist = max(hoist, size__(tensors[i]->index()));
+    }
+
+  inter.resize(1 << n);
+  for (int s = 1; s != (1 << n); ++s) {
+    int h = n-1;
+    while (!(s & (1 << h))) --h;
+    Cost dummy;
+    inter[s] = s == (1 << h) ? tensors[h]->index() : contract__(inter[s ^ (1 << h)], tensors[h]->index(), dummy);
+  }
+
+  targets.resize(Cost::transpose_aware() ? 1 << n : 0);
+  for (int s = 1; s < targets.size(); ++s) {
+    list<shared_ptr<Tensor>> t;
+    for (int i = 0; i != n; ++i)
+      if (s & (1 << i)) t.push_back(tensors[i]);
+    targets[s] = target_index__(t);
+  }
+
+  // best orderings of each subset, built by putting one of its tensors in front of the best orderings of the rest
+  best.resize(1 << n);
+  for (int i = 0; i != n; ++i)
+    best[1 << i].push_back(Ordering{Cost(), vector<int>{i}});
+  for (int s = 1; s != (1 << n); ++s) {
+    if (!(s & (s-1))) continue;
+    for (int i = 0; i != n; ++i) {
+      if (!(s & (1 << i))) continue;
+      for (auto& r : best[s ^ (1 << i)])
+        add_ordering__(best[s], extend(s, i, r));
+    }
+  }
+
+  flops.resize(1 << n);
+  for (int s = 1; s != (1 << n); ++s)
+    flops[s] = pick(s).cost.flops();
+}
+
+Ordering Chain::extend(const int s, const int i, const Ordering& r) const {
+  Ordering o = r;
+  // steps that are hoisted out of the iterations are not counted
+  Cost dummy;
+  Cost& cost = once(s) ? dummy : o.cost;
+  contract__(inter[s ^ (1 << i)], tensors[i]->index(), cost);
+  o.cost.sort_pcost();
+  if (Cost::transpose_aware()) {
+    shared_ptr<Tensor> a = tensors[i];
+    list<shared_ptr<const Index>> di;
+    for (auto& j : a->index())
+      if (none_of(targets[s].begin(), targets[s].end(), [&j](shared_ptr<const Index> k) { return j->identical(k); }))
+        di.push_back(j);
+    shared_ptr<Tensor> b = tensors[r.order.front()];
+    if (r.order.size() > 1) {
+      // the sort that wrote the intermediate is the identity unless its summed indices had to be moved
+      const list<shared_ptr<const Index>> index = Tensor::move_to_back(r.natural, di);
+      if (index != r.natural) cost.add_sort(size__(index));
+      b = make_shared<Tensor>(1.0, "I", index);
+    }
+    if (!identity__(a->sort_map(di))) cost.add_sort(size__(a->index()));
+    if (!identity__(b->sort_map(di))) cost.add_sort(size__(b->index()));
+    o.natural = Tensor::gemm_index(di, a, b);
+  }
+  o.order.insert(o.order.begin(), i);
+  return o;
+}
+
+const Ordering& Chain::pick(const int s) const {
+  const Ordering* o = &best[s].front();
+  for (auto& i : best[s])
+    if (!(o->cost < i.cost) || (i.cost < o->cost && i.order > o->order)) o = &i;
+  return *o;
+}
+
+/// A diagram summed into an intermediate: the tensors of its chain that are left and those put in front of them.
+struct Term {
+  const Chain* chain;
+  int left;
+  vector<int> front;
+};
+
+int popcount__(int s) {
+  int out = 0;
+  for ( ; s; s &= s-1) ++out;
+  return out;
+}
+
+/// Puts a tensor that some of the terms share in front of them when it saves FLOPs, so that Tree::factorize contracts it once with the sum of the rest, and does the same for the rest.
+void factorize__(const vector<Term*>& terms) {
+  vector<Term*> rest;
+  for (auto& t : terms)
+    if (popcount__(t->left) > 1) rest.push_back(t);
+  if (rest.size() < 2) return;
+
+  // equal tensors of the terms get the same class
+  vector<shared_ptr<Tensor>> classes;
+  map<Term*, vector<int>> cls;
+  for (auto& t : rest) {
+    const Chain& c = *t->chain;
+    vector<int>& k = cls[t];
+    for (int i = 0; i != c.tensors.size(); ++i) {
+      k.push_back(-1);
+      if (!(t->left & (1 << i))) continue;
+      auto j = find_if(classes.begin(), classes.end(), [&](shared_ptr<Tensor> x) { return *x == *c.tensors[i]; });
+      k.back() = j - classes.begin();
+      if (j == classes.end()) classes.push_back(c.tensors[i]);
+    }
+  }
+
+  while (rest.size() > 1) {
+    // one contraction with the tensor instead of one per term, and the rest of each term ordered without it
+    vector<double> gain(classes.size());
+    vector<vector<pair<Term*, int>>> groups(classes.size());
+    for (auto& t : rest) {
+      const vector<int>& k = cls[t];
+      for (int i = 0; i != k.size(); ++i) {
+        if (k[i] < 0 || any_of(k.begin(), k.begin()+i, [&](const int j) { return j == k[i]; })) continue;
+        if (groups[k[i]].empty()) gain[k[i]] -= t->chain->step(t->left, i);
+        gain[k[i]] += t->chain->flops[t->left] - t->chain->flops[t->left ^ (1 << i)];
+        groups[k[i]].push_back(make_pair(t, i));
+      }
+    }
+    int best = -1;
+    for (int k = 0; k != classes.size(); ++k)
+      if (groups[k].size() > 1 && gain[k] > 0.0 && (best < 0 || gain[k] > gain[best])) best = k;
+    if (best < 0) break;
+
+    vector<Term*> next;
+    for (auto& j : groups[best]) {
+      j.first->front.push_back(j.second);
+      j.first->left ^= 1 << j.second;
+      next.push_back(j.first);
+      rest.erase(find(rest.begin(), rest.end(), j.first));
+    }
+    factorize__(next);
+  }
+}
+
+
+/// Number of contractions left when Tree::factorize merges the orderings, i.e., distinct fronts of those with more than depth+1 tensors, recursively.
+int contractions__(const vector<vector<shared_ptr<Tensor>>*>& orders, const int depth) {
+  int out = 0;
+  vector<bool> done(orders.size());
+  for (int i = 0; i != orders.size(); ++i) {
+    if (done[i] || orders[i]->size() <= depth+1) continue;
+    vector<vector<shared_ptr<Tensor>>*> g;
+    for (int j = i; j != orders.size(); ++j)
+      if (!done[j] && orders[j]->size() > depth+1 && *(*orders[j])[depth] == *(*orders[i])[depth]) {
+        done[j] = true;
+        g.push_back(orders[j]);
+      }
+    out += 1 + contractions__(g, depth+1);
+  }
+  return out;
+}
+
+/// Contractions of the diagrams ordered on their own and after factorization.
+pair<long, long> contractions_count__;
+
+}
+
 ListTensor::ListTensor(shared_ptr<Diagram> d) {
   // factor
   fac_ = d->fac();
@@ -153,27 +458,7 @@ bool ListTensor::has_gamma() const {
 
 static int target_num__;
 shared_ptr<Tensor> ListTensor::target() const {
-  list<shared_ptr<const Index>> ind;
-  for (auto t = list_.begin(); t != list_.end(); ++t) {
-    list<shared_ptr<const Index>> index = (*t)->index();
-    for (auto j = index.begin(); j != index.end(); ++j) {
-      bool found = false;
-      list<shared_ptr<const Index>>::iterator remove;
-      for (auto i = ind.begin(); i != ind.end(); ++i) {
-        if ((*i)->num() == (*j)->num()) {
-          if ((*j)->label() == "ci") break;   // todo is there a better way?
-          found = true;
-          remove = i;
-          break;
-        }
-      }
-      if (found) {
-        ind.erase(remove);
-      } else {
-        ind.push_back(*j);
-      }
-    }
-  }
+  list<shared_ptr<const Index>> ind = target_index__(list_);
   stringstream ss;
   // make intermediate tensor
   ss << "I" << target_num__;
@@ -224,41 +509,8 @@ void ListTensor::print() const {
 shared_ptr<Cost> ListTensor::calculate_cost() const {
   auto out = make_shared<Cost>();
   list<shared_ptr<const Index>> current = list_.back()->index();
-
-  for (auto i = ++list_.rbegin(); i != list_.rend(); ++i) {
-    list<shared_ptr<const Index>> sumindex, outindex;
-    for (auto& a : current)
-      for (auto& b : (*i)->index())
-        if (a->same_num(b) && a->same_label(b))
-          sumindex.push_back(a);
-
-    current.insert(current.end(), (*i)->index().begin(), (*i)->index().end());
-    for (auto& a : current) {
-      bool check = false;
-      for (auto& b : sumindex)
-        if (a->same_num(b) && a->same_label(b))
-          check = true;
-      if (!check)
-        outindex.push_back(a);
-    }
-
-    sumindex.insert(sumindex.end(), outindex.begin(), outindex.end());
-    vector<int> cost(4);
-    for (auto& a : sumindex) {
-      if (a->label() == "c") cost[0] += 1;
-      else if (a->label() == "x") cost[1] += 1;
-      else if (a->label() == "a") cost[2] += 1;
-      else if (a->label() == "ci") cost[3] += 1;
-      else {
-        stringstream ss; ss << "this should not happen - ListTensor::calculate_cost " << a->label() << endl;
-        throw logic_error(ss.str());
-      }
-    }
-    auto pcost = make_shared<PCost>(cost);
-    out->add_pcost(*pcost);
-
-    current = outindex;
-  }
+  for (auto i = ++list_.rbegin(); i != list_.rend(); ++i)
+    current = contract__(current, (*i)->index(), *out);
 
   out->sort_pcost();
   assert(list_.size()-1 == out->cost().size());
@@ -266,28 +518,91 @@ shared_ptr<Cost> ListTensor::calculate_cost() const {
 }
 
 
-void ListTensor::reorder() {
-  // I need to sort list_ first
-  vector<shared_ptr<Tensor>> tmp(list_.begin(), list_.end());
-  sort(tmp.begin(), tmp.end(), Tensor::comp);
-  list<shared_ptr<Tensor>> out(tmp.begin(), tmp.end());
-  list_ = out;
+void ListTensor::reorder(const list<shared_ptr<ListTensor>>& terms, const bool hoist) {
+  list<Chain> chains;
+  list<Term> t;
+  for (auto& i : terms) {
+    chains.emplace_back(i->list_, hoist);
+    t.push_back(Term{&chains.back(), chains.back().all(), vector<int>()});
+  }
+  if (factorize_) {
+    vector<Term*> p;
+    for (auto& i : t) p.push_back(&i);
+    factorize__(p);
+  }
 
-  shared_ptr<Cost> current;
-  do {
-    shared_ptr<Cost> cost = calculate_cost();
-    if (!current || *cost < *current) {
-      out = list_;
-      current = cost;
+  vector<vector<shared_ptr<Tensor>>> alone, chosen;
+  auto l = terms.begin();
+  for (auto i = t.begin(); i != t.end(); ++i, ++l) {
+    const Chain& c = *i->chain;
+    Ordering a = c.pick(c.all());
+    vector<shared_ptr<Tensor>> v;
+    for (auto& j : a.order) v.push_back(c.tensors[j]);
+    const int n = v.size();
+    if (n > 1 && Tensor::comp(v[n-1], v[n-2])) swap(v[n-1], v[n-2]);
+    alone.push_back(v);
+
+    // the cheapest ordering of what is left, behind the tensors put in front
+    Ordering o = c.pick(i->left);
+    int s = i->left;
+    for (auto j = i->front.rbegin(); j != i->front.rend(); ++j) {
+      s |= 1 << *j;
+      o = c.extend(s, *j, o);
+    }
+    list<shared_ptr<Tensor>> out;
+    for (auto& j : o.order) out.push_back(c.tensors[j]);
+    (*l)->list_ = out;
+    shared_ptr<Cost> current = (*l)->calculate_cost();
+
+    // the last two are contracted first in either order, unless the last one has been put in front
+    if (o.order.size() - i->front.size() > 1) {
+      auto o0 = out.rbegin();
+      auto o1 = o0; ++o1;
+      if (Tensor::comp(*o0, *o1)) swap(*o0, *o1);
+    }
+    (*l)->list_ = out;
+    chosen.push_back(vector<shared_ptr<Tensor>>(out.begin(), out.end()));
+
+    if (report_ && current) {
+      // tensors are contracted from the back
+      stringstream ss;
+      for (auto j = out.rbegin(); j != out.rend(); ++j)
+        ss << (j == out.rbegin() ? "" : " * ") << (*j)->str();
+      const int bytes = DataType == "double" ? 8 : 16;
+      ss << "   (" << current->show() << "peak intermediate " << setprecision(3) << current->memory() * bytes / 1.0e6 << " MB";
+      if (Cost::transpose_aware()) ss << ", sort traffic " << o.cost.sort_traffic() * bytes / 1.0e6 << " MB";
+      ss << ")";
+      lock_guard<mutex> lock(orderings_mutex__);
+      ++orderings__[ss.str()];
     }
-  } while (next_permutation(list_.begin(), list_.end(), Tensor::comp));
-
-  if (out.size() > 1) {
-    auto o0 = out.rbegin();
-    auto o1 = o0; ++o1;
-    if (Tensor::comp(*o0, *o1)) swap(*o0, *o1);
   }
-  list_ = out;
+
+  // the contraction of the front tensor of the diagrams and those of the orderings
+  vector<vector<shared_ptr<Tensor>>*> pa, pc;
+  for (auto& i : alone) pa.push_back(&i);
+  for (auto& i : chosen) pc.push_back(&i);
+  const int before = 1 + contractions__(pa, 0);
+  const int after = 1 + contractions__(pc, 0);
+  Stats::count("contractions before factorization", before);
+  Stats::count("contractions after factorization", after);
+  lock_guard<mutex> lock(orderings_mutex__);
+  contractions_count__.first += before;
+  contractions_count__.second += after;
+}
+
+
+string ListTensor::orderings() {
+  if (!report_) return "";
+  stringstream ss;
+  ss << "   ***  Orderings  ***" << endl << endl;
+  ss << "  dimensions " << IndexMap::show_dimensions() << endl;
+  ss << "  orderings are chosen by " << Cost::show_weights() << endl;
+  lock_guard<mutex> lock(orderings_mutex__);
+  ss << "  " << contractions_count__.second << " contractions (" << contractions_count__.first << " with each diagram ordered on its own)" << endl << endl;
+  for (auto& i : orderings__)
+    ss << setw(6) << i.second << "x  " << i.first << endl;
+  ss << endl;
+  return ss.str();
 }
 
 
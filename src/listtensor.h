@@ -46,6 +46,10 @@ class ListTensor {
     /// Braket information.
     std::pair<bool, bool> braket_;
 
+    /// Whether the orderings chosen by reorder() are recorded.
+    static bool report_;
+    /// Whether reorder() factors out tensors that diagrams share.
+    static bool factorize_;
 
   public:
     /// Constructs a list of tensors in a diagram by constructing tensors from the operators in diagram, IF they have labels.
@@ -91,8 +95,16 @@ class ListTensor {
 
     /// evaluate the cost of computing this diagram as in the current order
     std::shared_ptr<Cost> calculate_cost() const;
-    /// reorder the tensors so that the cost is minimal
-    void reorder();
+    /// Reorders the tensors of diagrams that are summed into the same target so that the cost is minimal. Tensors that some of them share are put in front when that saves FLOPs, so that Tree::factorize contracts them once.
+    /// If hoist, the diagrams are computed in every iteration, and steps that do not involve the amplitudes are not counted (see Forest::hoist_invariants).
+    static void reorder(const std::list<std::shared_ptr<ListTensor>>& terms, const bool hoist = false);
+    /// Orders each diagram on its own (--no-factorize).
+    static void set_factorize(const bool b) { factorize_ = b; }
+
+    /// Records the orderings chosen by reorder() (--orderings).
+    static void set_report(const bool b) { report_ = b; }
+    /// Returns the recorded orderings and the dimensions they were chosen for, or nothing if not recorded.
+    static std::string orderings();
 };
 
 }
@@ -31,11 +31,15 @@
 #include "constants.h"
 #include "forest.h"
 #include "residual.h"
+#include "estimate.h"
+#include "option.h"
+#include "stats.h"
 
 using namespace std;
 using namespace smith;
 
-int main() {
+int main(int argc, char** argv) {
+  parse_options(argc, argv);
 
   string theory="CASPT2";
 
@@ -2610,29 +2614,18 @@ int main() {
   auto fr = make_shared<Forest>(trees);
 
   fr->filter_gamma();
+  fr->hoist_invariants();
+  fr->share_intermediates();
   list<shared_ptr<Tensor>> gm = fr->gamma();
   const list<shared_ptr<Tensor>> gamma = gm;
 
-  auto tmp = fr->generate_code();
-
-  ofstream fs(fr->name() + ".h");
-  ofstream es(fr->name() + "_tasks.h");
-  ofstream cs(fr->name() + "_gen.cc");
-  ofstream ds(fr->name() + "_tasks.cc");
-  ofstream gs(fr->name() + ".cc");
-  ofstream gg(fr->name() + "_gamma.cc");
-  fs << tmp.ss.str();
-  es << tmp.tt.str();
-  cs << tmp.cc.str();
-  ds << tmp.dd.str();
-  gs << tmp.ee.str();
-  gg << tmp.gg.str();
-  fs.close();
-  es.close();
-  cs.close();
-  ds.close();
-  gs.close();
-  gg.close();
+  // the generated code is written to the files as it is generated
+  OutStream out(fr->name(), fr->queues());
+  fr->generate_code(out);
+  out.close();
+  Estimate::write(fr->name() + "_estimates.json");
+  for (auto i : {&out.ss, &out.tt, &out.cc, &out.dd, &out.ee, &out.gg})
+    Stats::count("bytes " + i->file(), i->size());
   cout << std::endl;
 
   // output
@@ -2651,6 +2644,8 @@ int main() {
   cout << std::endl << "   ***  CI derivative  ***" << std::endl << std::endl;
   tdedcia->print();
   cout << std::endl << std::endl;
+  cout << ListTensor::orderings();
+  Stats::report();
 
   return 0;
 }
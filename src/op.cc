@@ -67,11 +67,11 @@ void Op::print() const {
 shared_ptr<Operator> Op::copy() const {
   // in the case of two-body operators
   if (c_) {
-    return make_shared<Op>(label_, a_->label(), b_->label(), c_->label(), d_->label(), rho(0)->alpha(), rho(1)->alpha());
+    return make_pooled<Op>(label_, a_->label(), b_->label(), c_->label(), d_->label(), rho(0)->alpha(), rho(1)->alpha());
   } else if (a_)  {
-    return make_shared<Op>(label_, a_->label(), b_->label(), rho(0)->alpha());
+    return make_pooled<Op>(label_, a_->label(), b_->label(), rho(0)->alpha());
   } else {
-    return make_shared<Op>(label_);
+    return make_pooled<Op>(label_);
   }
 }
 
@@ -97,7 +97,7 @@ pair<bool, double> Op::permute(const bool proj) {
   if ((num_active_nodagger() && num_active_dagger()) || (!proj && (label_ == "" || label_ == "proj")))
     return make_pair(false, 1.0);
 
-  const vector<int> prev = perm_;
+  const SmallVector<int, 2> prev = perm_;
   const int size = prev.size();
   bool next = next_permutation(perm_.begin(), perm_.end());
 
@@ -31,25 +31,25 @@ using namespace std;
 using namespace smith;
 
 Operator::Operator(const string& ta, const string& tb, const bool alpha)
-  : a_(make_shared<Index>(ta,true)), b_(make_shared<Index>(tb,false)) {
+  : a_(make_pooled<Index>(ta,true)), b_(make_pooled<Index>(tb,false)) {
   op_.push_back(make_tuple(&a_, ta!="x"?0:2, 0)); // index, dagger, spin
   op_.push_back(make_tuple(&b_, tb!="x"?0:2, 0));
-  rho_.push_back(make_shared<Spin>(alpha));
+  rho_.push_back(make_pooled<Spin>(alpha));
 
   perm_.push_back(0);
 }
 
 
 Operator::Operator(const string& ta, const string& tb, const string& tc, const string& td, const bool alpha1, const bool alpha2)
-  : a_(make_shared<Index>(ta,true)), b_(make_shared<Index>(tb,true)), c_(make_shared<Index>(tc,false)), d_(make_shared<Index>(td,false)) {
+  : a_(make_pooled<Index>(ta,true)), b_(make_pooled<Index>(tb,true)), c_(make_pooled<Index>(tc,false)), d_(make_pooled<Index>(td,false)) {
   // accept aa,ii and rearrange it to ai,ai
   op_.push_back(make_tuple(&a_, ta!="x"?0:2, 0)); // index, no-active/active, spin
   op_.push_back(make_tuple(&d_, td!="x"?0:2, 0)); // from historical reasons, it is 0 and 2. -1 when contracted.
   op_.push_back(make_tuple(&b_, tb!="x"?0:2, 1));
   op_.push_back(make_tuple(&c_, tc!="x"?0:2, 1));
 
-  rho_.push_back(make_shared<Spin>(alpha1));
-  rho_.push_back(make_shared<Spin>(alpha2));
+  rho_.push_back(make_pooled<Spin>(alpha1));
+  rho_.push_back(make_pooled<Spin>(alpha2));
 
   perm_.push_back(0);
   perm_.push_back(1);
@@ -106,16 +106,16 @@ bool Operator::general() const {
 int Operator::num_general() const {
   int out = 0;
   for (auto& i : op_)
-    if((*get<0>(i))->label() ==  "g") ++out;
+    if((*get<0>(i))->type() == IndexMap::general) ++out;
   return out;
 }
 
 
 void Operator::mutate_general(int& in) {
   for (auto& i : op_) {
-    if ((*get<0>(i))->label() ==  "g") {
+    if ((*get<0>(i))->type() == IndexMap::general) {
       if (in & 1) {
-        (*get<0>(i))->set_label("x");
+        (*get<0>(i))->set_type(IndexMap::active());
         get<1>(i) += 2;
       }
       in >>= 1;  // decrease in by one bit
@@ -189,11 +189,11 @@ pair<shared_ptr<Index>*, shared_ptr<Spin>* > Operator::first_dagger_noactive() {
 
 
 shared_ptr<Index>* Operator::survive(shared_ptr<Index>* a, shared_ptr<Index>* b) {
-  string alab = (*a)->label();
-  string blab = (*b)->label();
+  const int alab = (*a)->type();
+  const int blab = (*b)->type();
   if (alab == blab) return a;
-  else if (alab == "g" && blab != "g") return b;
-  else if (alab != "g" && blab == "g") return a;
+  else if (alab == IndexMap::general && blab != IndexMap::general) return b;
+  else if (alab != IndexMap::general && blab == IndexMap::general) return a;
   else throw logic_error("A strange thing happened in Op::survive");
 };
 
@@ -206,7 +206,7 @@ tuple<double, shared_ptr<Spin>, shared_ptr<Spin>>
   shared_ptr<Spin> a, b;
   for (; i != op_.end(); ++i) {
     if (get<1>(*i)!=0 || (*get<0>(*i))->dagger()) continue;
-    if (contractable((*get<0>(*i))->label(), (*dat.first)->label())) {
+    if (contractable((*get<0>(*i))->type(), (*dat.first)->type())) {
       if (cnt == skip) {
         const int n1 = (*dat.first)->num();
         const int n2 = (*get<0>(*i))->num();
@@ -29,9 +29,13 @@
 #include <vector>
 #include <map>
 #include "index.h"
+#include "smallvector.h"
 
 namespace smith {
 
+/// Operator entries: index object pointer, operator info, and spin info (see Operator::op_).
+using OpList = SmallVector<std::tuple<std::shared_ptr<Index>*, int, int>, 4>;
+
 /// Abstract base class for spin-summed operators.
 class Operator {
   protected:
@@ -46,10 +50,11 @@ class Operator {
     // get<2>  :  Spin info (0 or 1).
     //
     /// Tuple with index object pointer, operator info, and spin info (0 or 1). Operator info is defined as -1: no operator (i.e., already contracted), 0: operator, 2: active operator.
-    std::list<std::tuple<std::shared_ptr<Index>*, int, int>> op_;
+    /// Stored inline (at most two-body operators), so that scans do not chase list nodes.
+    OpList op_;
 
     /// Spin operator info.
-    std::vector<std::shared_ptr<Spin>> rho_;
+    SmallVector<std::shared_ptr<Spin>, 2> rho_;
 
     /// First excitation index.
     std::shared_ptr<Index> a_;
@@ -62,7 +67,7 @@ class Operator {
     std::shared_ptr<Index> d_;
 
     /// This is permutation count.
-    std::vector<int> perm_;
+    SmallVector<int, 2> perm_;
 
   public:
     /// Create one-body base operator. alpha = true means this operator is alpha spin only (for spin RDMs).
@@ -110,7 +115,7 @@ class Operator {
     /// Set spin.
     void set_rho(const int i, std::shared_ptr<Spin> a) { rho_[i] = a; }
     /// Returns spin.
-    std::vector<std::shared_ptr<Spin>>& rho() { return rho_; }
+    SmallVector<std::shared_ptr<Spin>, 2>& rho() { return rho_; }
     /// Returns const spin.
     std::shared_ptr<Spin> rho(const int i) const { return rho_.at(i); }
     /// Returns a const pointer to spin.
@@ -119,9 +124,9 @@ class Operator {
     std::shared_ptr<Spin>* rho_ptr(const int i) { return &rho_.at(i); };
 
     /// Return const operator reference.
-    const std::list<std::tuple<std::shared_ptr<Index>*, int, int>>& op() const { return op_; }
+    const OpList& op() const { return op_; }
     /// Return operator reference.
-    std::list<std::tuple<std::shared_ptr<Index>*, int, int>>& op() { return op_; }
+    OpList& op() { return op_; }
 
 
     /// CAUTION:: this function returns the first daggered operator (not an active operator, nor already contracted) **AND** deletes the corresponding entry from this->op_, by marking as contracted.
@@ -132,7 +137,7 @@ class Operator {
       contract(std::pair<std::shared_ptr<Index>*, std::shared_ptr<Spin>* >& dat, const int skip);
 
     /// Returns if you can contract two labels. Labels (type) must be same or one must be of type general in order to do contraction. Dagger info is not checked here but in contract function.
-    bool contractable(std::string a, std::string b) { return a == b || a == "g" || b == "g"; };
+    bool contractable(const int a, const int b) { return a == b || a == IndexMap::general || b == IndexMap::general; };
 
     /// Returns which index to be kept when contraction is performed.
     std::shared_ptr<Index>* survive(std::shared_ptr<Index>* a, std::shared_ptr<Index>* b);
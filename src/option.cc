@@ -0,0 +1,125 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: option.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <stdexcept>
+#include "option.h"
+#include "parallel.h"
+#include "equation.h"
+#include "stats.h"
+#include "sink.h"
+#include "listtensor.h"
+#include "forest.h"
+
+using namespace std;
+using namespace smith;
+
+namespace {
+
+void usage__(const string& prog) {
+  cout << "usage: " << prog << " [options]" << endl;
+  cout << "  --threads n      number of worker threads (default: SMITH3_NUM_THREADS or all cores)" << endl;
+  cout << "  --depth-first    contract diagrams depth first to bound memory" << endl;
+  cout << "  --no-arena       allocate diagram copies on the heap instead of in arenas" << endl;
+  cout << "  --dim l=n        dimension n of index class l (c, x, a or ci) in the cost model that orders contractions" << endl;
+  cout << "  --dims f         read the dimensions from f, one \"l n\" per line" << endl;
+  cout << "  --cost-weights f,m,d[,s]  order contractions by f log FLOPs + m log peak intermediate size + d log data movement" << endl;
+  cout << "                   + s log sort_indices traffic (default 1,0,0,0); s > 0 also lays out intermediates to save sorts" << endl;
+  cout << "  --no-factorize   order each diagram on its own, factoring out only the tensors that happen to come last" << endl;
+  cout << "  --no-hoist       recompute the Gamma tensors and the intermediates of the CASPT2 residual that no amplitude enters in every iteration" << endl;
+  cout << "  --no-share       compute intermediates that occur more than once in a queue each time, and generate task classes for each" << endl;
+  cout << "  --orderings      print the chosen contraction orderings and the dimensions they were chosen for" << endl;
+  cout << "  --stats          print wall time, peak memory and object counts per phase, and write them to smith3_stats.json" << endl;
+  cout << "  --stats-json f   as --stats, writing the JSON report to f" << endl;
+  cout << "  --shard n        split the task files into shards of n tasks and the queues into files of their own, for BAGEL" << endl;
+  cout << "  --shard-cost c   as --shard, starting a new shard at an estimated compile cost of c lines (see NAME_shards.json)" << endl;
+  cout << "  --help           print this message" << endl;
+}
+
+}
+
+void smith::parse_options(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+    if (arg == "--threads") {
+      if (++i == argc) throw runtime_error("--threads requires an argument");
+      set_num_threads(atoi(argv[i]));
+    } else if (arg == "--depth-first") {
+      Equation::set_depth_first(true);
+    } else if (arg == "--no-arena") {
+      Arena::set_enabled(false);
+    } else if (arg == "--dim") {
+      if (++i == argc) throw runtime_error("--dim requires an argument");
+      const string dim = argv[i];
+      const size_t eq = dim.find('=');
+      if (eq == string::npos) throw runtime_error("--dim requires an argument of the form l=n");
+      IndexMap::set_dimension(dim.substr(0, eq), atoi(dim.substr(eq+1).c_str()));
+    } else if (arg == "--dims") {
+      if (++i == argc) throw runtime_error("--dims requires an argument");
+      IndexMap::read_dimensions(argv[i]);
+    } else if (arg == "--cost-weights") {
+      if (++i == argc) throw runtime_error("--cost-weights requires an argument");
+      double f, m, d, s = 0.0;
+      char c0, c1, c2 = ',';
+      stringstream ss(argv[i]);
+      if (!(ss >> f >> c0 >> m >> c1 >> d) || c0 != ',' || c1 != ',' || ((ss >> c2) && (c2 != ',' || !(ss >> s))))
+        throw runtime_error("--cost-weights requires an argument of the form f,m,d or f,m,d,s");
+      if (f < 0.0 || m < 0.0 || d < 0.0 || s < 0.0) throw runtime_error("--cost-weights must not be negative");
+      Cost::set_weights(f, m, d, s);
+    } else if (arg == "--no-factorize") {
+      ListTensor::set_factorize(false);
+    } else if (arg == "--no-hoist") {
+      Forest::set_hoist(false);
+    } else if (arg == "--no-share") {
+      Forest::set_share(false);
+    } else if (arg == "--orderings") {
+      ListTensor::set_report(true);
+    } else if (arg == "--stats") {
+      Stats::set_enabled(true);
+    } else if (arg == "--stats-json") {
+      if (++i == argc) throw runtime_error("--stats-json requires an argument");
+      Stats::set_enabled(true);
+      Stats::set_file(argv[i]);
+    } else if (arg == "--shard") {
+      if (++i == argc) throw runtime_error("--shard requires an argument");
+      if (atoi(argv[i]) <= 0) throw runtime_error("--shard requires a positive number of tasks");
+      ShardPlan::set_size(atoi(argv[i]));
+    } else if (arg == "--shard-cost") {
+      if (++i == argc) throw runtime_error("--shard-cost requires an argument");
+      if (atof(argv[i]) <= 0.0) throw runtime_error("--shard-cost requires a positive cost");
+      ShardPlan::set_cost(atof(argv[i]));
+    } else if (arg == "--help" || arg == "-h") {
+      usage__(argv[0]);
+      exit(0);
+    } else {
+      usage__(argv[0]);
+      throw runtime_error("unknown option " + arg);
+    }
+  }
+}
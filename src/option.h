@@ -0,0 +1,37 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: option.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __OPTION_H
+#define __OPTION_H
+
+namespace smith {
+
+/// Applies the command-line options of SMITH3. Prints the usage and exits for --help; throws for unknown options.
+void parse_options(int argc, char** argv);
+
+}
+
+#endif
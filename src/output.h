@@ -26,43 +26,182 @@
 #ifndef __SMITH_OUTPUT_H
 #define __SMITH_OUTPUT_H
 
-#include <sstream>
+#include <list>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "sink.h"
 
 namespace smith {
 
+/// Output text kept as a list of chunks. Text is appended at the end of the last chunk, and another Rope is appended by moving its chunks over.
+/// Each chunk carries the tag that was current when it was written (see mark()). If a sink is opened, chunks are written to it instead of being kept.
+class Rope : public std::ostream {
+  protected:
+    /// A piece of text and its tag.
+    struct Chunk {
+      int tag;
+      std::string text;
+    };
+
+    class Buffer : public std::streambuf {
+      protected:
+        /// A new chunk is started once the last one has reached this size.
+        static const size_t chunk_size_ = 1 << 16;
+
+        int_type overflow(int_type c) override {
+          if (c != traits_type::eof()) back().push_back(traits_type::to_char_type(c));
+          return c;
+        }
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+          back().append(s, n);
+          return n;
+        }
+
+      public:
+        std::list<Chunk> chunks_;
+        /// Tag of the text appended next.
+        int tag_ = Unset;
+        /// Sink, if any, its file name and the number of bytes written to it.
+        std::shared_ptr<Sink> sink_;
+        std::string file_;
+        size_t written_ = 0;
+
+        Buffer() { }
+        Buffer(Buffer&& o) : chunks_(std::move(o.chunks_)), tag_(o.tag_) { }
+        Buffer& operator=(Buffer&& o) { chunks_ = std::move(o.chunks_); tag_ = o.tag_; return *this; }
+
+        std::string& back() {
+          if (chunks_.empty() || chunks_.back().text.size() >= chunk_size_ || chunks_.back().tag != tag_) {
+            if (sink_) flush();
+            chunks_.push_back(Chunk{tag_, ""});
+          }
+          return chunks_.back().text;
+        }
+
+        /// Writes the chunks to the sink.
+        void flush() {
+          for (auto& i : chunks_) {
+            sink_->write(i.tag, i.text);
+            written_ += i.text.size();
+          }
+          chunks_.clear();
+        }
+    };
+    Buffer buf_;
+
+  public:
+    Rope() : std::ostream(nullptr) { rdbuf(&buf_); }
+    Rope(Rope&& o) : std::ostream(std::move(o)), buf_(std::move(o.buf_)) { set_rdbuf(&buf_); }
+    Rope& operator=(Rope&& o) { std::ostream::operator=(std::move(o)); buf_ = std::move(o.buf_); return *this; }
+    Rope(const Rope&) = delete;
+    Rope& operator=(const Rope&) = delete;
+
+    /// Streams everything appended from now on to the sink. close() has to be called at the end.
+    void open(std::shared_ptr<Sink> sink) {
+      buf_.sink_ = sink;
+      buf_.file_ = sink->name();
+    }
+    /// Writes out what is left and closes the sink.
+    void close() {
+      if (!buf_.sink_) return;
+      buf_.flush();
+      buf_.sink_->close();
+      buf_.sink_.reset();
+    }
+    /// Returns the name of the file of the sink, empty if none has been opened.
+    const std::string& file() const { return buf_.file_; }
+
+    /// Tags the text appended from now on, e.g., with the number of the task it belongs to.
+    void mark(const int tag) { buf_.tag_ = tag; }
+
+    /// Moves the text of o to the end of this in constant time, or writes it out if a sink is open.
+    /// Text of o that has not been tagged takes the current tag of this, and the last tag of o becomes current.
+    void splice(Rope&& o) {
+      for (auto& i : o.buf_.chunks_)
+        if (i.tag == Unset) i.tag = buf_.tag_;
+      if (o.buf_.tag_ != Unset) buf_.tag_ = o.buf_.tag_;
+      buf_.chunks_.splice(buf_.chunks_.end(), o.buf_.chunks_);
+      if (buf_.sink_) buf_.flush();
+    }
+
+    /// Returns the total length of the text, including what has been written to the sink.
+    size_t size() const {
+      size_t out = buf_.written_;
+      for (auto& i : buf_.chunks_) out += i.text.size();
+      return out;
+    }
+    /// Returns the text as one string.
+    std::string str() const {
+      if (buf_.written_) throw std::logic_error("Rope::str() called after the text was written to a sink");
+      std::string out;
+      out.reserve(size());
+      for (auto& i : buf_.chunks_) out += i.text;
+      return out;
+    }
+};
+
+
+/// Generated code for the six output files. Move-only; emitters return it by value and it is appended with operator<< by splicing.
 struct OutStream {
-  std::stringstream ss; //name.h
-  std::stringstream tt; //name_tasks.h
-  std::stringstream cc; //name_gen.cc
-  std::stringstream dd; //name_tasks.cc
-  std::stringstream ee; //name.cc
-  std::stringstream gg; //name_gamma.cc
+  Rope ss; //name.h
+  Rope tt; //name_tasks.h
+  Rope cc; //name_gen.cc
+  Rope dd; //name_tasks.cc
+  Rope ee; //name.cc
+  Rope gg; //name_gamma.cc
+  Rope pp; //body of the precompute queue, moved to name.cc by Forest::generate_code
 
   OutStream() { }
-  OutStream(const OutStream& o) {
-    ss << o.ss.str();
-    tt << o.tt.str();
-    cc << o.cc.str();
-    dd << o.dd.str();
-    ee << o.ee.str();
-    gg << o.gg.str();
+  /// Output that is written to the files of the method name as it is appended. Split into shards if ShardPlan::enabled().
+  OutStream(const std::string& name, const std::vector<std::string>& queues) {
+    ss.open(std::make_shared<FileSink>(name + ".h"));
+    if (ShardPlan::enabled()) {
+      auto plan = std::make_shared<ShardPlan>(name);
+      tt.open(std::make_shared<TaskShards>(plan, ShardPlan::Header));
+      cc.open(std::make_shared<TaskShards>(plan, ShardPlan::Gen));
+      dd.open(std::make_shared<TaskShards>(plan, ShardPlan::Tasks));
+      ee.open(std::make_shared<QueueShards>(name, "", queues));
+      gg.open(std::make_shared<QueueShards>(name, "_gamma"));
+    } else {
+      tt.open(std::make_shared<FileSink>(name + "_tasks.h"));
+      cc.open(std::make_shared<FileSink>(name + "_gen.cc"));
+      dd.open(std::make_shared<FileSink>(name + "_tasks.cc"));
+      ee.open(std::make_shared<FileSink>(name + ".cc"));
+      gg.open(std::make_shared<FileSink>(name + "_gamma.cc"));
+    }
+  }
+  OutStream(OutStream&&) = default;
+  OutStream& operator=(OutStream&&) = default;
+
+  /// Tags the task code appended from now on with the task number.
+  void mark(const int task) {
+    tt.mark(task);
+    cc.mark(task);
+    dd.mark(task);
   }
-  OutStream& operator=(const OutStream& a) {
-    ss.str(std::string()); tt.str(std::string()); cc.str(std::string()); dd.str(std::string()); ee.str(std::string()); gg.str(std::string());
-    ss.clear(); tt.clear(); cc.clear(); dd.clear(); ee.clear(); gg.clear();
-    ss << a.ss.str(); tt << a.tt.str(); cc << a.cc.str(); dd << a.dd.str(); ee << a.ee.str(); gg << a.gg.str();
-    return *this;
+
+  void close() {
+    ss.close();
+    tt.close();
+    cc.close();
+    dd.close();
+    ee.close();
+    gg.close();
   }
 };
 
 namespace {
-OutStream& operator<<(OutStream& o, const OutStream& a) {
-  o.ss << a.ss.str();
-  o.tt << a.tt.str();
-  o.cc << a.cc.str();
-  o.dd << a.dd.str();
-  o.ee << a.ee.str();
-  o.gg << a.gg.str();
+OutStream& operator<<(OutStream& o, OutStream&& a) {
+  o.ss.splice(std::move(a.ss));
+  o.tt.splice(std::move(a.tt));
+  o.cc.splice(std::move(a.cc));
+  o.dd.splice(std::move(a.dd));
+  o.ee.splice(std::move(a.ee));
+  o.gg.splice(std::move(a.gg));
+  o.pp.splice(std::move(a.pp));
   return o;
 }
 }
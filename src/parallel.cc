@@ -0,0 +1,49 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: parallel.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <cstdlib>
+#include "parallel.h"
+
+using namespace std;
+using namespace smith;
+
+namespace {
+int nthreads__ = 0;
+}
+
+int smith::num_threads() {
+  if (nthreads__ <= 0) {
+    const char* env = getenv("SMITH3_NUM_THREADS");
+    nthreads__ = env ? atoi(env) : thread::hardware_concurrency();
+    if (nthreads__ <= 0) nthreads__ = 1;
+  }
+  return nthreads__;
+}
+
+
+void smith::set_num_threads(const int n) {
+  nthreads__ = n;
+}
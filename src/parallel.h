@@ -0,0 +1,76 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: parallel.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __PARALLEL_H
+#define __PARALLEL_H
+
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace smith {
+
+/// Returns the number of worker threads. Defaults to SMITH3_NUM_THREADS if set, or else to the number of cores.
+int num_threads();
+/// Sets the number of worker threads.
+void set_num_threads(const int n);
+
+/// Calls f(i) for 0 <= i < n on the worker threads. f(i) may only modify the data that belongs to i.
+template<typename F>
+void parallel_for(const int n, F f) {
+  const int nthreads = std::min(n, num_threads());
+  if (nthreads <= 1) {
+    for (int i = 0; i != n; ++i) f(i);
+    return;
+  }
+
+  std::atomic<int> next(0);
+  std::exception_ptr error;
+  std::atomic_flag error_lock = ATOMIC_FLAG_INIT;
+  auto work = [&]() {
+    for (int i = next++; i < n; i = next++) {
+      try {
+        f(i);
+      } catch (...) {
+        if (!error_lock.test_and_set()) error = std::current_exception();
+        next = n;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i != nthreads; ++i)
+    threads.emplace_back(work);
+  work();
+  for (auto& i : threads) i.join();
+  if (error) std::rethrow_exception(error);
+}
+
+}
+
+#endif
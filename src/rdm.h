@@ -30,6 +30,15 @@
 
 namespace smith {
 
+/// Orders delta functions by index number, so that the generated code does not depend on where the indices were allocated.
+struct DeltaComp {
+  bool operator()(const std::shared_ptr<const Index>& a, const std::shared_ptr<const Index>& b) const {
+    return a->num() != b->num() ? a->num() < b->num() : a < b;
+  }
+};
+/// Kronecker's delta functions.
+using DeltaMap = std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>, DeltaComp>;
+
 /// Abstract base class for reduced density matrices (RDMs).
 class RDM {
   protected:
@@ -38,7 +47,7 @@ class RDM {
     /// Operators that constitute RDM.
     std::list<std::shared_ptr<const Index>> index_;
     /// Kronecker's delta, map with two index pointers.
-    std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>> delta_;
+    DeltaMap delta_;
 
     /// Inherits bra from diagram, done in active ctor.
     bool bra_;
@@ -71,7 +80,7 @@ class RDM {
   public:
     /// Make RDM object from list of indices, delta indices and factor.
     RDM(const std::list<std::shared_ptr<const Index>>& in,
-        const std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>>& in2, std::pair<bool, bool> braket,
+        const DeltaMap& in2, std::pair<bool, bool> braket,
         const double& f = 1.0)
       : fac_(f), index_(in), delta_(in2), bra_(braket.first), ket_(braket.second) { }
     virtual ~RDM() { }
@@ -106,9 +115,9 @@ class RDM {
     const std::list<std::shared_ptr<const Index>>& index() const { return index_; }
 
     /// Returns a const reference of delta_.
-    const std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>>& delta() const { return delta_; }
+    const DeltaMap& delta() const { return delta_; }
     /// Returns a reference of delta_.
-    std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>>& delta() { return delta_; }
+    DeltaMap& delta() { return delta_; }
 
     /// Returns if this is in the final form..ie aligned as a0+ a0 a1+ a1..Member function located in active.cc
     bool done() const;
@@ -43,7 +43,7 @@ shared_ptr<RDM> RDM00::copy() const {
     if (dict.find(o) == dict.end()) {
       (*j)->set_spin(o);
     } else {
-      auto s = make_shared<Spin>(o->alpha());
+      auto s = make_pooled<Spin>(o->alpha());
       s->set_num(o->num());
       dict.insert(make_pair(o,s));
       (*j)->set_spin(s);
@@ -51,13 +51,13 @@ shared_ptr<RDM> RDM00::copy() const {
   }
 
   // lastly clone all the delta functions
-  map<shared_ptr<const Index>, shared_ptr<const Index>> d;
+  DeltaMap d;
   for (auto& i : delta_) d.insert(make_pair(i.first->clone(), i.second->clone()));
 
   list<shared_ptr<const Index>> inc;
   for (auto& i : in) inc.push_back(i);
 
-  auto out = make_shared<RDM00>(inc, d, make_pair(bra_, ket_));
+  auto out = make_pooled<RDM00>(inc, d, make_pair(bra_, ket_));
   out->fac() = fac_;
   return out;
 }
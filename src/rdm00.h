@@ -72,7 +72,7 @@ class RDM00 : public RDM {
   public:
     /// Make RDM object from list of indices, delta indices and factor.
     RDM00(const std::list<std::shared_ptr<const Index>>& in,
-        const std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>>& in2, std::pair<bool, bool> braket,
+        const DeltaMap& in2, std::pair<bool, bool> braket,
         const double& f = 1.0)
       : RDM(in, in2, braket, f) { }
     virtual ~RDM00() { }
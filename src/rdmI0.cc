@@ -43,7 +43,7 @@ shared_ptr<RDM> RDMI0::copy() const {
     if (dict.find(o) == dict.end()) {
       (*j)->set_spin(o);
     } else {
-      auto s = make_shared<Spin>(/*TODO alpha*/false);
+      auto s = make_pooled<Spin>(/*TODO alpha*/false);
       s->set_num(o->num());
       dict.insert(make_pair(o,s));
       (*j)->set_spin(s);
@@ -51,13 +51,13 @@ shared_ptr<RDM> RDMI0::copy() const {
   }
 
   // lastly clone all the delta functions
-  map<shared_ptr<const Index>, shared_ptr<const Index>> d;
+  DeltaMap d;
   for (auto& i : delta_) d.insert(make_pair(i.first->clone(), i.second->clone()));
 
   list<shared_ptr<const Index>> inc;
   for (auto& i : in) inc.push_back(i);
 
-  shared_ptr<RDM> out(new RDMI0(inc, d, make_pair(bra_, ket_)));
+  shared_ptr<RDM> out = make_pooled<RDMI0>(inc, d, make_pair(bra_, ket_));
   out->fac() = fac_;
   return out;
 }
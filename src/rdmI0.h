@@ -85,7 +85,7 @@ class RDMI0 : public RDM {
   public:
     /// Make RDM object from list of indices, delta indices and factor.
     RDMI0(const std::list<std::shared_ptr<const Index>>& in,
-        const std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>>& in2, std::pair<bool, bool> braket,
+        const DeltaMap& in2, std::pair<bool, bool> braket,
         const double& f = 1.0)
       : RDM(in, in2, braket, f) { }
     /// Copy RDM but use new indices for index. Useful when have kets, see active reduce.
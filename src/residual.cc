@@ -26,13 +26,33 @@
 #include <iomanip>
 #include "constants.h"
 #include "residual.h"
+#include "estimate.h"
+#include "stats.h"
 
 using namespace std;
 using namespace smith;
 
+namespace {
+
+/// Returns the alpha of the dgemm that applies the factors and scalars of the tensors and the factor of the target.
+string alpha__(const vector<shared_ptr<const Tensor>>& tensors, double factor) {
+  string scalars;
+  for (auto& i : tensors) {
+    factor *= i->factor();
+    if (!i->scalar().empty()) scalars += "*" + i->scalar() + "_";
+  }
+  const string p = prefac__(factor);
+  const size_t comma = p.find(',');
+  const string den = p.substr(comma + 1);
+  return p.substr(0, comma) + ".0" + (den != "1" ? "/" + den + ".0" : "") + scalars;
+}
+
+}
+
 
 OutStream Residual::create_target(const int i) const {
   OutStream out;
+  out.mark(i);
 
   out.tt << "class Task" << i << " : public Task {" << endl;
   out.tt << "  protected:" << endl;
@@ -47,6 +67,7 @@ OutStream Residual::create_target(const int i) const {
   out.tt << "    }" << endl;
   out.tt << "" << endl;
   out.tt << "  public:" << endl;
+  out.tt << Estimate().members(i);
   out.tt << "    Task" << i << "(std::vector<std::shared_ptr<Tensor>> t, const bool reset);" << endl;
 
   out.cc << "Task" << i << "::Task" << i << "(vector<shared_ptr<Tensor>> t, const bool reset) : reset_(reset) {" << endl;
@@ -66,6 +87,7 @@ OutStream Residual::create_target(const int i) const {
 
 OutStream Residual::create_target_ci(const int i) const {
   OutStream out;
+  out.mark(i);
 
   out.tt << "class Task" << i << " : public Task {" << endl;
   out.tt << "  protected:" << endl;
@@ -90,6 +112,7 @@ OutStream Residual::create_target_ci(const int i) const {
   out.tt << "    }" << endl;
   out.tt << "" << endl;
   out.tt << "  public:" << endl;
+  out.tt << Estimate().members(i);
   out.tt << "    Task" << i << "(std::vector<std::shared_ptr<Tensor>> t, const bool reset);" << endl;
 
   out.cc << "Task" << i << "::Task" << i << "(vector<shared_ptr<Tensor>> t, const bool reset) : reset_(reset) {" << endl;
@@ -170,21 +193,24 @@ OutStream Residual::generate_task(const int ip, const int ic, const vector<strin
     indent += "  ";
   }
   const bool is_gamma = op.front().find("Gamma") != string::npos;
-  tmp << indent << "  auto tensor" << ic << " = vector<shared_ptr<Tensor>>{" << merge__(op, label_) << "};" << endl;
+  tmp << indent << "  auto tensor" << ic << " = vector<shared_ptr<Tensor>>{" << merge__(op, label_, !is_gamma && gamma_kept()) << "};" << endl;
   tmp << indent << "  " << (diagonal ? "" : "auto ") << "task" << ic
                 << " = make_shared<Task" << ic << ">(tensor" << ic << ", pindex"
                 << (scalar.empty() ? "" : ", this->e0_") << ");" << endl;
 
   if (!is_gamma) {
+    // the tasks of a hoisted tree go to the precompute queue, which runs before the tasks that read it and the reset of the target
     if (parent_) {
       assert(parent_->parent());
-      tmp << indent << "  task" << ip << "->add_dep(task" << ic << ");" << endl;
-      tmp << indent << "  task" << ic << "->add_dep(task" << i0 << ");" << endl;
+      if (!parent_->hoisted())
+        tmp << indent << "  task" << ip << "->add_dep(task" << ic << ");" << endl;
+      if (!hoisted())
+        tmp << indent << "  task" << ic << "->add_dep(task" << i0 << ");" << endl;
     } else {
       assert(depth() == 0);
       tmp << indent << "  task" << ic << "->add_dep(task" << i0 << ");" << endl;
     }
-    tmp << indent << "  " << label_ << "q->add_task(task" << ic << ");" << endl;
+    tmp << indent << "  " << (hoisted() ? "precompute" : label_) << "q->add_task(task" << ic << ");" << endl;
   }
   if (diagonal)
     tmp << "  }" << endl;
@@ -214,6 +240,7 @@ OutStream Residual::generate_compute_header(const int ic, const list<shared_ptr<
 
   const int nindex = ti.size();
   OutStream out;
+  out.mark(ic);
   out.tt << "class Task" << ic << " : public Task {" << endl;
   out.tt << "  protected:" << endl;
   out.tt << "    std::shared_ptr<Tensor> out_;" << endl;
@@ -292,6 +319,7 @@ OutStream Residual::generate_compute_footer(const int ic, const list<shared_ptr<
   out.tt << "    }" << endl << endl;
 
   out.tt << "  public:" << endl;
+  out.tt << Estimate(tensors).members(ic);
   out.tt << "    Task" << ic << "(std::vector<std::shared_ptr<Tensor>> t, std::array<std::shared_ptr<const IndexRange>,3> range" << (need_e0 ? ", const double e" : "") << ");" << endl;
 
   out.cc << "Task" << ic << "::Task" << ic << "(vector<shared_ptr<Tensor>> t, array<shared_ptr<const IndexRange>,3> range" << (need_e0 ? ", const double e" : "") << ") {" << endl;
@@ -355,14 +383,25 @@ OutStream Residual::generate_bc(const shared_ptr<BinaryContraction> i) const {
     const string bindent = "  ";
     string dindent = bindent;
 
-    out.dd << target_->generate_get_block(dindent, "o", "out()", true);
-    out.dd << target_->generate_scratch_area(dindent, "o", "out()", true); // true means zero-out
-
     list<shared_ptr<const Index>> ti = depth() != 0 ? i->target_indices() : i->tensor()->index();
+    list<shared_ptr<const Index>> di = i->loop_indices();
+
+    // all the factors and scalars go into the alpha of dgemm, and blocks that sort_indices would only copy are used as they are
+    const bool direct0 = i->tensor()->sort_identity(di);
+    const bool direct1 = i->next_target()->sort_identity(di);
+    const bool direct = i->target()->sort_identity_target(di, i->tensor(), i->next_target());
+    const string alpha = alpha__({i->tensor(), i->next_target()}, i->target()->factor());
+    const string i0data = direct0 ? "i0data" : "i0data_sorted";
+    const string i1data = direct1 ? "i1data" : "i1data_sorted";
+    const string odata = direct ? "odata" : "odata_sorted";
+    Stats::count("elided sort_indices", direct0 + direct1 + direct);
+
+    out.dd << target_->generate_get_block(dindent, "o", "out()", true);
+    if (!direct)
+      out.dd << target_->generate_scratch_area(dindent, "o", "out()", true); // true means zero-out
 
     // inner loop will show up here
     // but only if outer loop is not empty
-    list<shared_ptr<const Index>> di = i->loop_indices();
     vector<string> close2;
     vector<string> close3;
     string inlabel("in("); inlabel += (same_tensor__(i->tensor()->label(), i->next_target()->label()) ? "0)" : "1)");
@@ -428,9 +467,11 @@ OutStream Residual::generate_bc(const shared_ptr<BinaryContraction> i) const {
     }
 
     // retrieving tensor_
-    out.dd << i->tensor()->generate_sort_indices(dindent, "i0", "in(0)", di, false, true) << endl;
+    if (!direct0)
+      out.dd << i->tensor()->generate_sort_indices(dindent, "i0", "in(0)", di, false, /*noscale*/true) << endl;
     // retrieving subtree_
-    out.dd << i->next_target()->generate_sort_indices(dindent, "i1", inlabel, di, false, true) << endl;
+    if (!direct1)
+      out.dd << i->next_target()->generate_sort_indices(dindent, "i1", inlabel, di, false, /*noscale*/true) << endl;
 
     // call dgemm or ddot (if only vector - vector contraction is made)
     {
@@ -442,12 +483,12 @@ OutStream Residual::generate_bc(const shared_ptr<BinaryContraction> i) const {
         string tt1 = t1.first == "" ? "1" : t1.first;
         string ss0 = t1.second== "" ? "1" : t1.second;
         out.dd << tt0 << ", " << tt1 << ", " << ss0 << "," << endl;
-        out.dd << dindent << "       1.0, i0data_sorted, " << ss0 << ", i1data_sorted, " << ss0 << "," << endl
-           << dindent << "       1.0, odata_sorted, " << tt0;
+        out.dd << dindent << "       " << alpha << ", " << i0data << ", " << ss0 << ", " << i1data << ", " << ss0 << "," << endl
+           << dindent << "       1.0, " << odata << ", " << tt0;
         out.dd << ");" << endl;
       } else {
         string ss0 = t1.second== "" ? "1" : t1.second;
-        out.dd << dindent << "odata_sorted[0] += ddot_(" << ss0 << ", i0data_sorted, 1, i1data_sorted, 1);" << endl;
+        out.dd << dindent << odata << "[0] += " << (alpha != "1.0" ? alpha + " * " : "") << "ddot_(" << ss0 << ", " << i0data << ", 1, " << i1data << ", 1);" << endl;
       }
     }
 
@@ -464,8 +505,8 @@ OutStream Residual::generate_bc(const shared_ptr<BinaryContraction> i) const {
     // Inner loop ends here
 
     // sort buffer
-    {
-      out.dd << i->target()->generate_sort_indices_target(bindent, "o", di, i->tensor(), i->next_target());
+    if (!direct) {
+      out.dd << i->target()->generate_sort_indices_target(bindent, "o", di, i->tensor(), i->next_target(), /*noscale*/true);
     }
     // put buffer
     {
@@ -553,6 +594,7 @@ OutStream Residual::generate_header_sources(const int ic, const list<shared_ptr<
 
   const int nindex = ti.size();
   OutStream out;
+  out.mark(ic);
   out.tt << "class Task" << ic << " : public Task {" << endl;
   out.tt << "  protected:" << endl;
   out.tt << "    std::shared_ptr<Tensor> out_;" << endl;
@@ -622,6 +664,7 @@ OutStream Residual::generate_footer_sources(const int ic, const list<shared_ptr<
   out.tt << "    }" << endl << endl;
 
   out.tt << "  public:" << endl;
+  out.tt << Estimate(tensors).members(ic);
   out.tt << "    Task" << ic << "(std::vector<std::shared_ptr<Tensor>> t, std::array<std::shared_ptr<const IndexRange>,3> range" << (need_e0 ? ", const double e" : "") << ");" << endl;
 
   out.cc << "Task" << ic << "::Task" << ic << "(vector<shared_ptr<Tensor>> t, array<shared_ptr<const IndexRange>,3> range" << (need_e0 ? ", const double e" : "") << ") {" << endl;
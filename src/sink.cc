@@ -0,0 +1,260 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: sink.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include "constants.h"
+#include "sink.h"
+
+using namespace std;
+using namespace smith;
+
+int ShardPlan::size_ = 0;
+double ShardPlan::cost_ = 0.0;
+
+namespace {
+
+const string guard__ = "#include <bagel_config.h>\n#ifdef COMPILE_SMITH\n\n";
+
+/// Weights of the compile cost estimate, in lines.
+const double loop_cost__ = 1.0;
+const double template_cost__ = 20.0;
+
+string lower__(string s) {
+  transform(s.begin(), s.end(), s.begin(), ::tolower);
+  return s;
+}
+
+unique_ptr<ofstream> open__(const string& file) {
+  unique_ptr<ofstream> out(new ofstream(file));
+  if (!*out) throw runtime_error("could not open " + file);
+  return out;
+}
+
+void write__(ofstream& f, const string& text, const string& file) {
+  f.write(text.data(), text.size());
+  if (!f) throw runtime_error("could not write " + file);
+}
+
+}
+
+
+FileSink::FileSink(const string& file) : Sink(file), file_(open__(file)) {
+}
+
+
+void FileSink::write(const int, const string& text) {
+  write__(*file_, text, name_);
+}
+
+
+double ShardPlan::estimate(const string& code, set<string>& templates) {
+  double out = 0.0;
+  for (size_t begin = 0; begin < code.size(); ) {
+    size_t end = code.find('\n', begin);
+    if (end == string::npos) end = code.size();
+    out += 1.0;
+    // loops are weighted by their nesting, read off the indentation
+    const size_t indent = code.find_first_not_of(' ', begin);
+    if (indent < end && code.compare(indent, 5, "for (") == 0)
+      out += loop_cost__ * ((indent - begin) / 2);
+    begin = end + 1;
+  }
+  for (const string t : {"sort_indices<", "SubTask<"}) {
+    for (size_t i = code.find(t); i != string::npos; i = code.find(t, i+1)) {
+      const size_t j = code.find('>', i);
+      if (templates.insert(code.substr(i, j-i+1)).second)
+        out += template_cost__;
+    }
+  }
+  return out;
+}
+
+
+string ShardPlan::file(const Kind kind, const int n) const {
+  const string number = n ? to_string(n) : "";
+  switch (kind) {
+    case Header: return method_ + "_tasks" + number + ".h";
+    case Gen:    return method_ + "_gen" + number + ".cc";
+    default:     return method_ + "_tasks" + number + ".cc";
+  }
+}
+
+
+string ShardPlan::prologue_(const Kind kind, const int n) const {
+  stringstream ss;
+  ss << header(file(kind, n)) << guard__;
+  if (kind == Header) {
+    ss << "#ifndef __SRC_SMITH_" << method_ << "_TASKS" << n << "_H" << endl;
+    ss << "#define __SRC_SMITH_" << method_ << "_TASKS" << n << "_H" << endl << endl;
+    ss << "#include <src/smith/indexrange.h>" << endl;
+    ss << "#include <src/smith/tensor.h>" << endl;
+    ss << "#include <src/smith/task.h>" << endl;
+    ss << "#include <src/smith/subtask.h>" << endl;
+    ss << "#include <src/smith/storage.h>" << endl << endl;
+    ss << "namespace bagel {" << endl;
+    ss << "namespace SMITH {" << endl;
+    ss << "namespace " << method_ << "{" << endl << endl;
+  } else {
+    ss << "#include <src/smith/" << lower__(method_) << "/" << file(Header, n) << ">" << endl << endl;
+    ss << "using namespace std;" << endl;
+    ss << "using namespace bagel;" << endl;
+    ss << "using namespace bagel::SMITH;" << endl;
+    ss << "using namespace bagel::SMITH::" << method_ << ";" << endl << endl;
+  }
+  return ss.str();
+}
+
+
+void ShardPlan::write(const Kind kind, const int tag, const string& text) {
+  if (tag == Banner || tag == Prologue || tag == Epilogue) return; // each shard has its own
+  if (tag < 0) throw logic_error("code outside of a task in " + file(kind, 0));
+  if (!shards_.empty() && tag <= shards_.back().last) throw logic_error("code of a task that has already been written in " + file(kind, 0));
+  pending_[tag][kind] += text;
+  seen_[kind] = max(seen_[kind], tag);
+  // code of a task is complete once all three files have moved on to later tasks
+  assign_(*min_element(seen_.begin(), seen_.end()));
+}
+
+
+void ShardPlan::assign_(const int before) {
+  for (auto i = pending_.begin(); i != pending_.end() && i->first < before; i = pending_.erase(i)) {
+    const array<string,3>& code = i->second;
+    bool next = shards_.empty();
+    if (!next && size_ > 0)
+      next = shards_.back().last - shards_.back().first + 1 >= size_;
+    if (!next && cost_ > 0.0) {
+      const Shard& s = shards_.back();
+      array<set<string>,3> templates = s.templates;
+      const double cost = 2.0*estimate(code[Header], templates[Header]) + estimate(code[Gen], templates[Gen]) + estimate(code[Tasks], templates[Tasks]);
+      next = s.total() + cost - cost_ > cost_ - s.total();
+    }
+    if (next) {
+      shards_.emplace_back(i->first);
+      for (const Kind k : {Header, Gen, Tasks}) {
+        shards_.back().files[k] = open__(file(k, shards_.size()));
+        write__(*shards_.back().files[k], prologue_(k, shards_.size()), file(k, shards_.size()));
+      }
+    }
+    Shard& s = shards_.back();
+    s.last = i->first;
+    for (const Kind k : {Header, Gen, Tasks}) {
+      s.cost[k] += estimate(code[k], s.templates[k]);
+      write__(*s.files[k], code[k], file(k, shards_.size()));
+    }
+  }
+}
+
+
+void ShardPlan::close() {
+  if (++nclosed_ != 3) return;
+  assign_(numeric_limits<int>::max());
+
+  for (int n = 1; n <= shards_.size(); ++n) {
+    for (const Kind k : {Header, Gen, Tasks}) {
+      write__(*shards_[n-1].files[k], k == Header ? "}\n}\n}\n#endif\n#endif\n" : "#endif\n", file(k, n));
+      shards_[n-1].files[k]->close();
+    }
+  }
+
+  stringstream ss;
+  ss << header(file(Header, 0)) << guard__;
+  ss << "#ifndef __SRC_SMITH_" << method_ << "_TASKS_H" << endl;
+  ss << "#define __SRC_SMITH_" << method_ << "_TASKS_H" << endl << endl;
+  for (int n = 1; n <= shards_.size(); ++n)
+    ss << "#include <src/smith/" << lower__(method_) << "/" << file(Header, n) << ">" << endl;
+  ss << endl << "#endif" << endl << "#endif" << endl;
+  write__(*open__(file(Header, 0)), ss.str(), file(Header, 0));
+
+  write_manifest_();
+}
+
+
+void ShardPlan::write_manifest_() const {
+  // the cost of a source file includes that of the header of its shard
+  const string file = method_ + "_shards.json";
+  stringstream ss;
+  ss << fixed << setprecision(1);
+  ss << "{" << endl;
+  ss << "  \"method\": \"" << method_ << "\"," << endl;
+  ss << "  \"cost_unit\": \"lines, plus " << loop_cost__ << " per loop and nesting level and " << template_cost__ << " per template instantiation\"," << endl;
+  ss << "  \"shards\": [";
+  for (int n = 1; n <= shards_.size(); ++n) {
+    const Shard& s = shards_[n-1];
+    ss << (n == 1 ? "" : ",") << endl << "    {\"shard\": " << n << ", \"first_task\": " << s.first << ", \"last_task\": " << s.last << ", \"cost\": " << s.total()
+       << ", \"files\": {\"" << this->file(Header, n) << "\": " << s.cost[Header]
+       << ", \"" << this->file(Gen, n) << "\": " << s.cost[Header] + s.cost[Gen]
+       << ", \"" << this->file(Tasks, n) << "\": " << s.cost[Header] + s.cost[Tasks] << "}}";
+  }
+  ss << endl << "  ]" << endl;
+  ss << "}" << endl;
+  write__(*open__(file), ss.str(), file);
+}
+
+
+QueueShards::QueueShards(const string& method, const string& stem, const vector<string>& queues)
+  : Sink(method + stem + ".cc"), method_(method), queues_(queues), file_(open__(name_)) {
+}
+
+
+void QueueShards::write(const int tag, const string& text) {
+  if (tag < 0) {
+    if (tag != Banner && !guarded_) {
+      write__(*file_, guard__, name_);
+      guarded_ = true;
+    }
+    write__(*file_, text, name_);
+    return;
+  }
+  if (tag >= queues_.size()) throw logic_error("unknown queue in " + name_);
+  const string file = method_ + "_" + queues_[tag] + "q.cc";
+  auto iter = shards_.find(tag);
+  if (iter == shards_.end()) {
+    iter = shards_.emplace(tag, open__(file)).first;
+    stringstream ss;
+    ss << header(file) << guard__;
+    ss << "#include <src/smith/" << lower__(method_) << "/" << method_ << ".h>" << endl;
+    ss << "#include <src/smith/" << lower__(method_) << "/" << method_ << "_tasks.h>" << endl << endl;
+    ss << "using namespace std;" << endl;
+    ss << "using namespace bagel;" << endl;
+    ss << "using namespace bagel::SMITH;" << endl << endl;
+    write__(*iter->second, ss.str(), file);
+  }
+  write__(*iter->second, text, file);
+}
+
+
+void QueueShards::close() {
+  for (auto& i : shards_) {
+    const string file = method_ + "_" + queues_[i.first] + "q.cc";
+    write__(*i.second, "#endif\n", file);
+    i.second->close();
+  }
+  write__(*file_, "#endif\n", name_);
+  file_->close();
+}
@@ -0,0 +1,172 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: sink.h
+// Copyright (C) 2014 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __SMITH_SINK_H
+#define __SMITH_SINK_H
+
+#include <array>
+#include <fstream>
+#include <map>
+#include <set>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace smith {
+
+/// Tags of the parts of the generated files that are not task or queue code. Task code is tagged with its task number, and queue code with the position of its tree.
+enum Section : int { Unset = -1, Banner = -2, Prologue = -3, Body = -4, Epilogue = -5 };
+
+/// Destination of one of the generated files. The text arrives in order, each piece with its tag.
+class Sink {
+  protected:
+    /// Name of the file as if it were not split.
+    std::string name_;
+
+  public:
+    Sink(const std::string& name) : name_(name) { }
+    virtual ~Sink() { }
+
+    /// Returns the name of the file as if it were not split.
+    const std::string& name() const { return name_; }
+
+    /// Writes text that carries a tag.
+    virtual void write(const int tag, const std::string& text) = 0;
+    /// Completes and closes the files.
+    virtual void close() = 0;
+};
+
+
+/// Writes everything into one file.
+class FileSink : public Sink {
+  protected:
+    std::unique_ptr<std::ofstream> file_;
+
+  public:
+    FileSink(const std::string& file);
+
+    void write(const int, const std::string& text) override;
+    void close() override { file_->close(); }
+};
+
+
+/// Assigns the tasks of a method to shards and writes them, e.g., CASPT2_tasks1.h, CASPT2_gen1.cc and CASPT2_tasks1.cc in place of CASPT2_tasks.h,
+/// CASPT2_gen.cc and CASPT2_tasks.cc. Tasks are assigned in order once all of their code has arrived. A new shard is started when the current one
+/// has the given number of tasks, or when adding the task would take it further from the given estimated compile cost than leaving it out.
+/// Each shard gets its own includes, CASPT2_tasks.h includes all the shards, and the estimates are written to CASPT2_shards.json.
+class ShardPlan {
+  public:
+    /// The three files of a shard.
+    enum Kind : int { Header = 0, Gen = 1, Tasks = 2 };
+
+  protected:
+    /// Number of tasks per shard, 0 if not limited.
+    static int size_;
+    /// Estimated compile cost per shard, 0 if not limited.
+    static double cost_;
+
+    struct Shard {
+      int first;
+      int last;
+      /// Estimated compile cost of the code in each file.
+      std::array<double,3> cost;
+      /// Template instantiations in each file, which are only paid for once per translation unit.
+      std::array<std::set<std::string>,3> templates;
+      std::array<std::unique_ptr<std::ofstream>,3> files;
+
+      Shard(const int task) : first(task), last(task), cost{{0.0, 0.0, 0.0}} { }
+      /// Estimated compile cost of the two translation units, which include the header.
+      double total() const { return 2.0*cost[Header] + cost[Gen] + cost[Tasks]; }
+    };
+
+    std::string method_;
+    std::vector<Shard> shards_;
+    /// Code of the tasks that have not been assigned yet.
+    std::map<int, std::array<std::string,3>> pending_;
+    /// Largest task seen in each file.
+    std::array<int,3> seen_;
+    int nclosed_;
+
+    std::string prologue_(const Kind kind, const int n) const;
+    /// Assigns the pending tasks before the given one.
+    void assign_(const int before);
+    void write_manifest_() const;
+
+  public:
+    ShardPlan(const std::string& method) : method_(method), seen_{{-1, -1, -1}}, nclosed_(0) { }
+
+    static void set_size(const int n) { size_ = n; }
+    static void set_cost(const double c) { cost_ = c; }
+    /// Whether the task files are split.
+    static bool enabled() { return size_ > 0 || cost_ > 0.0; }
+    /// Estimated compile cost of code, in lines. Template instantiations are added to the set and only counted if new.
+    static double estimate(const std::string& code, std::set<std::string>& templates);
+
+    /// Name of the file of kind in shard n (1-based); shard 0 is the file that is not split.
+    std::string file(const Kind kind, const int n) const;
+
+    void write(const Kind kind, const int tag, const std::string& text);
+    /// Closes one of the three files; when all of them are closed, assigns the rest and writes the umbrella header and the manifest.
+    void close();
+};
+
+
+/// One of the three task files of a method, written through the ShardPlan.
+class TaskShards : public Sink {
+  protected:
+    std::shared_ptr<ShardPlan> plan_;
+    ShardPlan::Kind kind_;
+
+  public:
+    TaskShards(std::shared_ptr<ShardPlan> plan, const ShardPlan::Kind kind) : Sink(plan->file(kind, 0)), plan_(plan), kind_(kind) { }
+
+    void write(const int tag, const std::string& text) override { plan_->write(kind_, tag, text); }
+    void close() override { plan_->close(); }
+};
+
+
+/// Writes the queue of each tree into its own file, e.g., CASPT2_residualq.cc, and the rest into the file itself.
+/// The files are guarded by COMPILE_SMITH from bagel_config.h.
+class QueueShards : public Sink {
+  protected:
+    std::string method_;
+    std::vector<std::string> queues_;
+    std::unique_ptr<std::ofstream> file_;
+    std::map<int, std::unique_ptr<std::ofstream>> shards_;
+    /// Whether the guard has been written after the banner.
+    bool guarded_ = false;
+
+  public:
+    /// Queues of method + "_" + queues[n] + "q.cc", the rest in method + stem + ".cc". Without queues, only the file is guarded.
+    QueueShards(const std::string& method, const std::string& stem, const std::vector<std::string>& queues = std::vector<std::string>());
+
+    void write(const int tag, const std::string& text) override;
+    void close() override;
+};
+
+}
+
+#endif
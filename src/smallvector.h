@@ -0,0 +1,79 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: smallvector.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __SMALLVECTOR_H
+#define __SMALLVECTOR_H
+
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace smith {
+
+/// Vector with a fixed capacity that is stored inline, used for the few indices and spins of an operator.
+template<typename T, int N>
+class SmallVector {
+  protected:
+    /// Elements; only the first size_ are used.
+    std::array<T, N> data_;
+    /// Number of elements.
+    int size_;
+
+  public:
+    SmallVector() : size_(0) { }
+
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    /// Appends an element. Throws if the capacity is exceeded.
+    void push_back(const T& t) {
+      if (size_ == N) throw std::logic_error("SmallVector::push_back exceeds the capacity");
+      data_[size_++] = t;
+    }
+
+    int size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    T& operator[](const int i) { assert(i < size_); return data_[i]; }
+    const T& operator[](const int i) const { assert(i < size_); return data_[i]; }
+    T& at(const int i) { if (i >= size_) throw std::out_of_range("SmallVector::at"); return data_[i]; }
+    const T& at(const int i) const { if (i >= size_) throw std::out_of_range("SmallVector::at"); return data_[i]; }
+
+    T& front() { return data_[0]; }
+    const T& front() const { return data_[0]; }
+    T& back() { return data_[size_-1]; }
+    const T& back() const { return data_[size_-1]; }
+
+    iterator begin() { return data_.data(); }
+    iterator end() { return data_.data() + size_; }
+    const_iterator begin() const { return data_.data(); }
+    const_iterator end() const { return data_.data() + size_; }
+};
+
+}
+
+#endif
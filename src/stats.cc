@@ -0,0 +1,164 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: stats.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <sys/resource.h>
+#include "stats.h"
+#include "parallel.h"
+#include "diagram.h"
+#include "active.h"
+
+using namespace std;
+using namespace smith;
+
+bool Stats::enabled_ = false;
+string Stats::file_ = "smith3_stats.json";
+
+namespace {
+
+struct PhaseData {
+  string name;
+  long calls;
+  double wall;
+  long rss;
+};
+
+mutex mutex__;
+vector<PhaseData> phases__;
+vector<pair<string, long>> counts__;
+const chrono::steady_clock::time_point start__ = chrono::steady_clock::now();
+
+double elapsed__(const chrono::steady_clock::time_point& t) {
+  return chrono::duration<double>(chrono::steady_clock::now() - t).count();
+}
+
+string escape__(const string& in) {
+  string out;
+  for (auto& c : in) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+}
+
+
+Stats::Phase::Phase(const string& name) : name_(name), enabled_(Stats::enabled()) {
+  if (enabled_) start_ = chrono::steady_clock::now();
+}
+
+
+void Stats::Phase::stop() {
+  if (!enabled_) return;
+  enabled_ = false;
+  const double wall = elapsed__(start_);
+  const long rss = peak_rss();
+  lock_guard<mutex> lock(mutex__);
+  auto i = find_if(phases__.begin(), phases__.end(), [this](const PhaseData& p) { return p.name == name_; });
+  if (i == phases__.end()) {
+    phases__.push_back(PhaseData{name_, 1, wall, rss});
+  } else {
+    ++i->calls;
+    i->wall += wall;
+    i->rss = max(i->rss, rss);
+  }
+}
+
+
+void Stats::count(const string& name, const long n) {
+  if (!enabled_) return;
+  lock_guard<mutex> lock(mutex__);
+  auto i = find_if(counts__.begin(), counts__.end(), [&name](const pair<string, long>& p) { return p.first == name; });
+  if (i == counts__.end()) counts__.push_back(make_pair(name, n));
+  else                     i->second += n;
+}
+
+
+long Stats::peak_rss() {
+  struct rusage r;
+  getrusage(RUSAGE_SELF, &r);
+  return r.ru_maxrss;
+}
+
+
+string Stats::summary() {
+  lock_guard<mutex> lock(mutex__);
+  stringstream ss;
+  ss << "   ***  Statistics  ***" << endl << endl;
+  ss << "  " << left << setw(32) << "phase" << right << setw(8) << "calls" << setw(12) << "wall (s)" << setw(14) << "peak RSS (MB)" << endl;
+  for (auto& i : phases__)
+    ss << "  " << left << setw(32) << i.name << right << setw(8) << i.calls << setw(12) << fixed << setprecision(3) << i.wall
+       << setw(14) << setprecision(1) << i.rss/1024.0 << endl;
+  ss << "  " << left << setw(32) << "total" << right << setw(8) << "" << setw(12) << setprecision(3) << elapsed__(start__)
+     << setw(14) << setprecision(1) << peak_rss()/1024.0 << endl << endl;
+  for (auto& i : counts__)
+    ss << "  " << left << setw(32) << i.first << right << setw(8) << i.second << endl;
+  ss << endl;
+  ss << Diagram::statistics() << endl;
+  ss << Active::statistics() << endl;
+  ss << Arena::statistics();
+  return ss.str();
+}
+
+
+string Stats::json() {
+  lock_guard<mutex> lock(mutex__);
+  stringstream ss;
+  ss << fixed << setprecision(6);
+  ss << "{" << endl;
+  ss << "  \"threads\": " << num_threads() << "," << endl;
+  ss << "  \"wall\": " << elapsed__(start__) << "," << endl;
+  ss << "  \"peak_rss_kb\": " << peak_rss() << "," << endl;
+  ss << "  \"phases\": [";
+  for (auto i = phases__.begin(); i != phases__.end(); ++i)
+    ss << (i == phases__.begin() ? "" : ",") << endl << "    {\"name\": \"" << escape__(i->name) << "\", \"calls\": " << i->calls
+       << ", \"wall\": " << i->wall << ", \"peak_rss_kb\": " << i->rss << "}";
+  ss << endl << "  ]," << endl;
+  ss << "  \"counts\": {";
+  for (auto i = counts__.begin(); i != counts__.end(); ++i)
+    ss << (i == counts__.begin() ? "" : ",") << endl << "    \"" << escape__(i->first) << "\": " << i->second;
+  ss << endl << "  }" << endl;
+  ss << "}" << endl;
+  return ss.str();
+}
+
+
+void Stats::report() {
+  if (!enabled_) return;
+  cout << summary() << endl;
+  ofstream fs(file_);
+  if (!fs) throw runtime_error("cannot open " + file_);
+  fs << json();
+}
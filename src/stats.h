@@ -0,0 +1,78 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: stats.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __STATS_H
+#define __STATS_H
+
+#include <chrono>
+#include <string>
+
+namespace smith {
+
+/// Wall time, peak resident memory and object counts of the phases of the generator (--stats).
+/// Phases and counters are kept in the order in which they are first seen.
+class Stats {
+  protected:
+    /// Whether anything is recorded.
+    static bool enabled_;
+    /// Path of the JSON report.
+    static std::string file_;
+
+  public:
+    /// Adds the wall time of its lifetime to the named phase.
+    class Phase {
+      protected:
+        std::string name_;
+        bool enabled_;
+        std::chrono::steady_clock::time_point start_;
+      public:
+        Phase(const std::string& name);
+        ~Phase() { stop(); }
+        /// Ends the phase before the end of the scope.
+        void stop();
+    };
+
+    static void set_enabled(const bool b) { enabled_ = b; }
+    static bool enabled() { return enabled_; }
+    /// Sets the path of the JSON report (default smith3_stats.json).
+    static void set_file(const std::string& f) { file_ = f; }
+
+    /// Adds n to the named counter.
+    static void count(const std::string& name, const long n);
+    /// Peak resident set size of this process in kB.
+    static long peak_rss();
+
+    /// Human-readable summary, followed by those of Diagram, Active and Arena.
+    static std::string summary();
+    /// The same information in JSON.
+    static std::string json();
+    /// Prints the summary and writes the JSON report if enabled.
+    static void report();
+};
+
+}
+
+#endif
@@ -26,6 +26,8 @@
 #include <iomanip>
 #include "tensor.h"
 #include "constants.h"
+#include "stats.h"
+#include "estimate.h"
 
 #define debug_tasks
 
@@ -135,12 +137,13 @@ bool Tensor::operator==(const Tensor& o) const {
 }
 
 
-string Tensor::constructor_str(const bool diagonal) const {
+string Tensor::constructor_str(const bool diagonal, const bool member) const {
   stringstream ss;
   string indent = "";
   if (diagonal) {
     indent += "  ";
-    ss << "  shared_ptr<Tensor> " << label() << ";" << endl;
+    if (!member)
+      ss << "  shared_ptr<Tensor> " << label() << ";" << endl;
     ss << "  if (diagonal) {" << endl;
   }
   ss << indent << "  vector<IndexRange> " << label() << "_index";
@@ -152,7 +155,7 @@ string Tensor::constructor_str(const bool diagonal) const {
       ss << (i != index_.rbegin() ? ", " : "") << (*i)->generate();
     ss << "};" << endl;
   }
-  ss << indent << "  " << (diagonal ? "" : "auto ") << label() << " = make_shared<Tensor>(" << label() << "_index);";
+  ss << indent << "  " << (diagonal || member ? "" : "auto ") << label() << " = make_shared<Tensor>(" << label() << "_index);";
   if (diagonal)
     ss << endl << "  }";
   return ss.str();
@@ -289,18 +292,41 @@ string Tensor::generate_scratch_area(const string cindent, const string lab, con
   return ss.str();
 }
 
-string Tensor::generate_sort_indices(const string cindent, const string lab, const string tensor_lab, const list<shared_ptr<const Index>>& loop, const bool op, const bool doscale) const {
-  stringstream ss;
-  if (!op) ss << generate_scratch_area(cindent, lab, tensor_lab, false);
+namespace {
+
+/// Indices of the result of the dgemm of a and b, fastest first (the order sort_indices reads odata_sorted in).
+list<shared_ptr<const Index>> gemm_source__(const list<shared_ptr<const Index>>& loop, const shared_ptr<Tensor> a, const shared_ptr<Tensor> b) {
+  list<shared_ptr<const Index>> source;
+  for (auto& t : {a, b}) {
+    list<shared_ptr<const Index>> aind = t->index();
+    // if t is a daggered tensor, we reverse
+    if (t->label().find("dagger") != string::npos) aind.reverse();
+    for (auto i = aind.rbegin(); i != aind.rend(); ++i) {
+      bool found = false;
+      for (auto& j : loop)
+        if ((*i)->identical(j)) found = true;
+      if (!found) source.push_back(*i);
+    }
+  }
+  return source;
+}
+
+bool identity__(const vector<int>& map) {
+  for (int i = 0; i != map.size(); ++i)
+    if (map[i] != i) return false;
+  return true;
+}
 
-  vector<int> map(index_.size());
+}
+
+
+vector<int> Tensor::sort_map(const list<shared_ptr<const Index>>& loop) const {
   // determine mapping
   // first loop indices. order as in loop
   vector<int> done;
 
   // if trans, transpose here!
-  size_t found = label_.find("dagger");
-  const bool trans = found != string::npos;
+  const bool trans = label_.find("dagger") != string::npos;
   if (trans && index_.size() & 1) throw logic_error("transposition not possible with 3-index objects");
   if (trans) {
     for (auto i = loop.rbegin(); i != loop.rend(); ++i) {
@@ -336,6 +362,19 @@ string Tensor::generate_sort_indices(const string cindent, const string lab, con
     }
   }
 
+  return done;
+}
+
+
+string Tensor::generate_sort_indices(const string cindent, const string lab, const string tensor_lab, const list<shared_ptr<const Index>>& loop, const bool op, const bool noscale) const {
+  stringstream ss;
+  if (!op) ss << generate_scratch_area(cindent, lab, tensor_lab, false);
+
+  const vector<int> done = sort_map(loop);
+  const bool trans = label_.find("dagger") != string::npos;
+  Stats::count("sort_indices", 1);
+  if (identity__(done)) Stats::count("identity sort_indices", 1);
+
   // then write them out.
   ss << cindent << "sort_indices<";
   for (auto& i : done)
@@ -343,7 +382,7 @@ string Tensor::generate_sort_indices(const string cindent, const string lab, con
 
   string target_label = op ? "odata" : lab + "data_sorted";
 
-  ss << (op ? 1 : 0) << ",1," << prefac__(factor_);
+  ss << (op ? 1 : 0) << ",1," << (noscale ? "1,1" : prefac__(factor_));
   ss << ">(" << lab << "data, " << target_label;
   if (!trans) {
     for (auto i = index_.rbegin(); i != index_.rend(); ++i)
@@ -354,48 +393,23 @@ string Tensor::generate_sort_indices(const string cindent, const string lab, con
     }
   }
   ss << ");" << endl;
-
-  if (!scalar_.empty() && doscale) {
-    ss << cindent << SCAL << "(";
-    for (auto i = index_.rbegin(); i != index_.rend(); ++i)
-      ss << (i != index_.rbegin() ? "*" : "") << (*i)->str_gen() << ".size()";
-    // update scalar_ name directly
-    ss << ", " << scalar_ << "_, " << lab << "data_sorted.get(), 1);" << endl;
-  }
   return ss.str();
 }
 
 
-string Tensor::generate_sort_indices_target(const string cindent, const string lab, const list<shared_ptr<const Index>>& loop,
-                                            const shared_ptr<Tensor> a, const shared_ptr<Tensor> b) const {
-  stringstream ss;
-  vector<int> map(index_.size());
-  ss << cindent << "sort_indices<";
+bool Tensor::sort_identity(const list<shared_ptr<const Index>>& loop) const {
+  return identity__(sort_map(loop));
+}
 
-  // determine mapping
-  // first obtain the ordering of indices from dgemm
-  list<shared_ptr<const Index>> source;
-  {
-    list<shared_ptr<const Index>> aind = a->index();
-    // if a is a daggered tensor, we reverse
-    if (a->label().find("dagger") != string::npos) aind.reverse();
-    for (auto i = aind.rbegin(); i != aind.rend(); ++i) {
-      bool found = false;
-      for (auto& j : loop)
-        if ((*i)->identical(j)) found = true;
-      if (!found) source.push_back(*i);
-    }
-    aind = b->index();
-    // if b is a daggered tensor, we reverse
-    if (b->label().find("dagger") != string::npos) aind.reverse();
-    for (auto i = aind.rbegin(); i != aind.rend(); ++i) {
-      bool found = false;
-      for (auto& j : loop)
-        if ((*i)->identical(j)) found = true;
-      if (!found) source.push_back(*i);
-    }
-  }
 
+bool Tensor::sort_identity_target(const list<shared_ptr<const Index>>& loop, const shared_ptr<Tensor> a, const shared_ptr<Tensor> b) const {
+  return identity__(sort_map_target(loop, a, b));
+}
+
+
+vector<int> Tensor::sort_map_target(const list<shared_ptr<const Index>>& loop, const shared_ptr<Tensor> a, const shared_ptr<Tensor> b) const {
+  const list<shared_ptr<const Index>> source = gemm_source__(loop, a, b);
+  vector<int> out;
   for (auto j = index_.rbegin(); j != index_.rend(); ++j) {
     // count
     int cnt = 0;
@@ -404,10 +418,47 @@ string Tensor::generate_sort_indices_target(const string cindent, const string l
       if ((*i)->identical(*j)) break;
     }
     if (cnt == index_.size()) throw logic_error("should not happen.. Tensor::generate_sort_indices_target");
-    ss << cnt << ",";
+    out.push_back(cnt);
   }
+  return out;
+}
+
+
+list<shared_ptr<const Index>> Tensor::gemm_index(const list<shared_ptr<const Index>>& loop, const shared_ptr<Tensor> a, const shared_ptr<Tensor> b) {
+  list<shared_ptr<const Index>> out = gemm_source__(loop, a, b);
+  out.reverse();
+  return out;
+}
+
+
+list<shared_ptr<const Index>> Tensor::move_to_back(const list<shared_ptr<const Index>>& index, const list<shared_ptr<const Index>>& loop) {
+  list<shared_ptr<const Index>> out, back;
+  for (auto& i : index)
+    if (none_of(loop.begin(), loop.end(), [&i](shared_ptr<const Index> j) { return i->identical(j); }))
+      out.push_back(i);
+  for (auto& j : loop)
+    for (auto& i : index)
+      if (i->identical(j)) {
+        back.push_back(i);
+        break;
+      }
+  out.insert(out.end(), back.begin(), back.end());
+  return out;
+}
+
+
+string Tensor::generate_sort_indices_target(const string cindent, const string lab, const list<shared_ptr<const Index>>& loop,
+                                            const shared_ptr<Tensor> a, const shared_ptr<Tensor> b, const bool noscale) const {
+  stringstream ss;
+  ss << cindent << "sort_indices<";
+  const list<shared_ptr<const Index>> source = gemm_source__(loop, a, b);
+  const vector<int> done = sort_map_target(loop, a, b);
+  Stats::count("sort_indices", 1);
+  if (identity__(done)) Stats::count("identity sort_indices", 1);
+  for (auto& i : done)
+    ss << i << ",";
 
-  ss << "1,1," << prefac__(factor_);
+  ss << "1,1," << (noscale ? "1,1" : prefac__(factor_));
   ss << ">(" << lab << "data_sorted, " << lab << "data";
   for (auto i = source.begin(); i != source.end(); ++i) ss << ", " << (*i)->str_gen() << ".size()";
   ss << ");" << endl;
@@ -617,6 +668,7 @@ OutStream Tensor::generate_gamma(const int ic, const bool use_blas, const bool d
 
 OutStream Tensor::generate_gamma_header_sources(const int ic, const bool use_blas, const bool der, const int nindex) const {
   OutStream out;
+  out.mark(ic);
 
 #ifdef debug_tasks
   out.tt << "class Task" << ic << " : public Task {" <<  "  // merged with gamma" << endl;
@@ -706,6 +758,7 @@ OutStream Tensor::generate_gamma_footer_sources(const int ic, const bool use_bla
   out.tt << "    }" << endl << endl;
 
   out.tt << "  public:" << endl;
+  out.tt << Estimate(*this).members(ic);
   out.tt << "    Task" << ic << "(std::vector<std::shared_ptr<Tensor>> t, std::array<std::shared_ptr<const IndexRange>,3> range);" << endl;
 
   out.cc << "Task" << ic << "::Task" << ic << "(vector<shared_ptr<Tensor>> t, array<shared_ptr<const IndexRange>,3> range) {" << endl;
@@ -772,6 +825,7 @@ OutStream Tensor::generate_gamma_footer_sources(const int ic, const bool use_bla
 
 OutStream Tensor::generate_gamma_header(const int ic, const bool use_blas, const bool der, const int nindex, const int ninptensors) const {
   OutStream out;
+  out.mark(ic);
 
 #ifdef debug_tasks
   out.tt << "class Task" << ic << " : public Task {" <<  "  // associated with gamma" << endl;
@@ -849,6 +903,7 @@ OutStream Tensor::generate_gamma_footer(const int ic, const bool use_blas, const
   out.tt << "    }" << endl << endl;
 
   out.tt << "  public:" << endl;
+  out.tt << Estimate(*this).members(ic);
   out.tt << "    Task" << ic << "(std::vector<std::shared_ptr<Tensor>> t, std::array<std::shared_ptr<const IndexRange>,3> range);" << endl;
 
   out.cc << "Task" << ic << "::Task" << ic << "(vector<shared_ptr<Tensor>> t, array<shared_ptr<const IndexRange>,3> range) {" << endl;
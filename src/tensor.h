@@ -129,6 +129,8 @@ class Tensor {
     void set_alias(std::shared_ptr<Tensor> o) { alias_ = o; }
     /// if tensor is a repeat.
     bool has_alias() const { return !!alias_; }
+    /// Checks if tensor is an amplitude, which changes in every iteration.
+    bool amplitude() const { return label_ == "t2" || label_ == "t2dagger" || label_ == "l2" || label_ == "l2dagger"; }
     /// Checks if tensor is gamma.
     bool is_gamma() const { return label_.find("Gamma") != std::string::npos; }
     /// if deriviative tensor
@@ -139,18 +141,30 @@ class Tensor {
 
     /// Generates string for constructor for tensors in Method.cc file
     std::string constructor_str_ci(const bool diagonal = false) const;
-    /// Generates string for constructor for tensors in Method.cc file
-    std::string constructor_str(const bool diagonal = false) const;
+    /// Generates string for constructor for tensors in Method.cc file. If member, the tensor is a member of the method declared in the header.
+    std::string constructor_str(const bool diagonal = false, const bool member = false) const;
     /// Generates code for get_block - source block to be added later to target (move) block.
     std::string generate_get_block(const std::string, const std::string, const std::string, const bool move = false, const bool noscale = false, int number = -2, bool merged = false, const std::list<std::shared_ptr<const Index>>& mergedlist = (std::list<std::shared_ptr<const Index>>()), const bool nonblocking = false) const;
     std::string generate_get_block_nb(const std::string a, const std::string b, const std::string c) const { return generate_get_block(a, b, c, false, true, -2, false, (std::list<std::shared_ptr<const Index>>()), true); }
     /// Generate code for unique_ptr scratch arrays.
     std::string generate_scratch_area(const std::string, const std::string, const std::string tensor_lab, const bool zero = false) const;
-    /// Generate code for sort_indices. Based on operations needed to sort input tensor to output tensor.
-    std::string generate_sort_indices(const std::string, const std::string, const std::string, const std::list<std::shared_ptr<const Index>>&, const bool op = false, const bool scale = false) const;
-    /// Generate code for final sort_indices back to target indices (those not summed over).
+    /// Generate code for sort_indices. Based on operations needed to sort input tensor to output tensor. If noscale, the factor is left to the caller.
+    std::string generate_sort_indices(const std::string, const std::string, const std::string, const std::list<std::shared_ptr<const Index>>&, const bool op = false, const bool noscale = false) const;
+    /// Returns the permutation generate_sort_indices applies to bring the loop indices to the front.
+    std::vector<int> sort_map(const std::list<std::shared_ptr<const Index>>& loop) const;
+    /// Returns true if generate_sort_indices would only copy the block, i.e., if the loop indices are already at the back.
+    bool sort_identity(const std::list<std::shared_ptr<const Index>>& loop) const;
+    /// Returns the permutation generate_sort_indices_target applies to the dgemm result of a and b.
+    std::vector<int> sort_map_target(const std::list<std::shared_ptr<const Index>>& loop, const std::shared_ptr<Tensor> a, const std::shared_ptr<Tensor> b) const;
+    /// Returns true if generate_sort_indices_target would only add the dgemm result of a and b to the block.
+    bool sort_identity_target(const std::list<std::shared_ptr<const Index>>& loop, const std::shared_ptr<Tensor> a, const std::shared_ptr<Tensor> b) const;
+    /// Returns the index order of a target for which the dgemm result of a and b needs no sorting.
+    static std::list<std::shared_ptr<const Index>> gemm_index(const std::list<std::shared_ptr<const Index>>& loop, const std::shared_ptr<Tensor> a, const std::shared_ptr<Tensor> b);
+    /// Returns index with the loop indices moved to the back in the order of loop, the layout for which generate_sort_indices is the identity.
+    static std::list<std::shared_ptr<const Index>> move_to_back(const std::list<std::shared_ptr<const Index>>& index, const std::list<std::shared_ptr<const Index>>& loop);
+    /// Generate code for final sort_indices back to target indices (those not summed over). If noscale, the factor is left to the caller.
     std::string generate_sort_indices_target(const std::string, const std::string, const std::list<std::shared_ptr<const Index>>&,
-                                             const std::shared_ptr<Tensor>, const std::shared_ptr<Tensor>) const;
+                                             const std::shared_ptr<Tensor>, const std::shared_ptr<Tensor>, const bool noscale = false) const;
     /// Obtain dimensions for code for tensor multiplication in dgemm.
     std::pair<std::string, std::string> generate_dim(const std::list<std::shared_ptr<const Index>>&) const;
     /// Generates code for RDMs.
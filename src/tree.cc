@@ -24,7 +24,9 @@
 
 
 #include "residual.h"
+#include "forest.h"
 #include "constants.h"
+#include "stats.h"
 
 using namespace std;
 using namespace smith;
@@ -36,6 +38,14 @@ Tree::Tree(shared_ptr<Equation> eq, string lab) : parent_(NULL), tree_name_(eq->
 
   const bool rt_targets = eq->targets();
 
+  Stats::count("trees", 1);
+  Stats::Phase phase("tree build");
+  vector<shared_ptr<Tensor>> fronts;
+  vector<shared_ptr<ListTensor>> rests;
+  vector<string> targets;
+  // diagrams that factorize() sums into the same intermediate
+  list<list<shared_ptr<ListTensor>>> groups;
+  list<int> heads;
   for (auto& i : d) {
     shared_ptr<ListTensor> tmp = make_shared<ListTensor>(i);
     // All internal tensor should be included in the active part
@@ -44,11 +54,33 @@ Tree::Tree(shared_ptr<Equation> eq, string lab) : parent_(NULL), tree_name_(eq->
     // rearrange brakets and reindex associated tensors, ok if not complex
     tmp->absorb_ket();
 
-    shared_ptr<Tensor> first = tmp->front();
-    shared_ptr<ListTensor> rest = tmp->rest();
+    fronts.push_back(tmp->front());
+    rests.push_back(tmp->rest());
+    stringstream ss;
+    for (auto& j : i->target_index()) ss << j->str(false) << " ";
+    targets.push_back(ss.str());
+
+    const int n = fronts.size()-1;
+    auto g = groups.begin();
+    auto k = heads.begin();
+    for ( ; g != groups.end(); ++g, ++k)
+      if (*fronts[*k] == *fronts[n] && rests[*k]->dagger() == rests[n]->dagger() && targets[*k] == targets[n]) break;
+    if (g == groups.end()) {
+      g = groups.insert(groups.end(), list<shared_ptr<ListTensor>>());
+      heads.push_back(n);
+    }
+    g->push_back(rests[n]);
+  }
 
-    // reorder to minimize the cost
-    rest->reorder();
+  // reorder to minimize the cost
+  for (auto& g : groups)
+    ListTensor::reorder(g, Forest::hoist() && iterated());
+
+  auto f = fronts.begin();
+  auto r = rests.begin();
+  for (auto& i : d) {
+    shared_ptr<Tensor> first = *f++;
+    shared_ptr<ListTensor> rest = *r++;
 
     // convert to tree and then bc
     shared_ptr<Tree> tr;
@@ -64,7 +96,9 @@ Tree::Tree(shared_ptr<Equation> eq, string lab) : parent_(NULL), tree_name_(eq->
     shared_ptr<BinaryContraction> b = make_shared<BinaryContraction>(lt, first, i->target_index());
     bc_.push_back(b);
   }
+  phase.stop();
 
+  Stats::Phase fphase("factorize");
   factorize();
   move_up_operator();
   set_parent_sub();
@@ -78,6 +112,11 @@ Tree::Tree(const shared_ptr<ListTensor> l, string lab, const bool t) : num_(-1),
   if (l->length() > 1) {
     shared_ptr<BinaryContraction> bc = make_shared<BinaryContraction>(target_, l, lab, root_targets_);
     bc_.push_back(bc);
+    // and the target takes the index order of the dgemm result, so that it is written without sorting
+    if (Cost::transpose_aware()) {
+      shared_ptr<Tree> sub = bc->subtree().front();
+      target_->set_index(Tensor::gemm_index(bc->loop_indices(), bc->tensor(), sub->can_move_up() ? sub->op().front() : sub->target()));
+    }
   } else {
     shared_ptr<Tensor> t = l->front();
     t->set_factor(l->fac());
@@ -104,6 +143,9 @@ BinaryContraction::BinaryContraction(shared_ptr<Tensor> o, shared_ptr<ListTensor
   }
   subtree_.push_back(tr);
 
+  // the intermediate computed by the subtree keeps the indices summed here at the back, so that it is used without sorting
+  if (Cost::transpose_aware() && rest->length() > 1)
+    tr->target()->set_index(Tensor::move_to_back(tr->target()->index(), loop_indices()));
 }
 
 
@@ -328,6 +370,27 @@ static string label__(const string& lbl) {
   }
   return label;
 }
+// returns the dependencies of task ic on the tasks that compute the intermediate of i, if they are in the same queue
+static string shared_depend__(const int ic, shared_ptr<BinaryContraction> i, const bool diagonal) {
+  stringstream ss;
+  if (!i->shared_queue() || i->hoisted()) return "";
+  for (auto& p : i->shared()->producers()) {
+    if (diagonal || p.second)
+      ss << "  if (diagonal)" << endl << "  ";
+    ss << "  task" << ic << "->add_dep(task" << p.first << ");" << endl;
+  }
+  ss << endl;
+  return ss.str();
+}
+// writes the constructor of intermediate s read by i; if i is hoisted, its intermediate is a member made by the precompute queue
+static void constructor__(OutStream& out, shared_ptr<Tensor> s, shared_ptr<BinaryContraction> i, const bool diagonal) {
+  if (i->hoisted() && s == i->next_target()) {
+    out.ss << "    std::shared_ptr<Tensor> " << s->label() << ";" << endl;
+    out.pp << s->constructor_str(diagonal, /*member*/true) << endl;
+  } else {
+    out.ee << s->constructor_str(diagonal) << endl;
+  }
+}
 // local functions... (not a good practice...) <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
 
@@ -520,6 +583,14 @@ OutStream Tree::generate_task(const int ic, const vector<shared_ptr<Tensor>> op,
   }
   out.ee << endl;
 #endif
+  // in the precompute queue the kept Gamma tensors are computed by tasks of their own
+  if (hoisted() && gamma_kept() && any_of(op.begin(), op.end(), [](shared_ptr<Tensor> i) { return i->label().find("Gamma") != string::npos; })) {
+    for (auto& i : op) {
+      if (i->label().find("Gamma") != string::npos)
+        out.ee << (diagonal ? "  if (diagonal)\n  " : "") << "  task" << ic << "->" << add_depend(i, g) << endl;
+    }
+    out.ee << endl;
+  }
 
   return out;
 }
@@ -544,13 +615,60 @@ tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
   OutStream out, tmp;
   string depends, tasks, specials;
 
+  // a shared intermediate is computed once per queue, and its task classes are generated once
+  if (shared_queue())
+    return make_tuple(move(out), tcnt, t0, itensors);
+  int n = shared_code() ? shared_->first_task() : tcnt;
   for (auto& i : subtree_) {
-    tie(tmp, tcnt, t0, itensors) = i->generate_task_list(tcnt, t0, gamma, itensors);
-    out << tmp;
+    tie(tmp, n, t0, itensors) = i->generate_task_list(n, t0, gamma, itensors);
+    out << move(tmp);
   }
-  return make_tuple(out, tcnt, t0, itensors);
+  return make_tuple(move(out), shared_code() ? tcnt : n, t0, itensors);
 }
 
+int BinaryContraction::count_tasks(int tcnt, vector<shared_ptr<Tensor>>& itensors) const {
+  // mirrors generate_task_list
+  producers_.clear();
+  if (shared_queue()) return tcnt;
+  first_task_ = shared_code() ? shared_->first_task() : tcnt;
+  int n = first_task_;
+  for (auto& i : subtree_) n = i->count_tasks(n, itensors);
+  return shared_code() ? tcnt : n;
+}
+
+
+int Tree::count_tasks(int tcnt, vector<shared_ptr<Tensor>>& itensors) const {
+  // mirrors generate_task_list, generate_task_list_zero and generate_steps
+  auto add = [&itensors](shared_ptr<Tensor> s) {
+    if (find(itensors.begin(), itensors.end(), s) == itensors.end() && s->label().find("I") != string::npos && !s->has_alias())
+      itensors.push_back(s);
+  };
+  if (depth() == 0) {
+    if (root_targets()) {
+      ++tcnt;
+      for (auto& j : bc_) {
+        for (auto& s : j->tensors_vec()) add(s);
+        tcnt = j->count_tasks(tcnt + 1, itensors);
+      }
+    } else {
+      for (auto& j : bc_) tcnt = j->count_tasks(tcnt, itensors);
+    }
+  } else {
+    if (!op_.empty()) {
+      if (find(itensors.begin(), itensors.end(), target_) == itensors.end()) itensors.push_back(target_);
+      const bool diagonal = nogamma_upstream() && none_of(op_.begin(), op_.end(), [](shared_ptr<Tensor> i) { return i->label().find("Gamma") != string::npos; });
+      parent_->add_producer(tcnt++, diagonal);
+    }
+    for (auto& i : bc_) {
+      for (auto& s : i->tensors_vec()) add(s);
+      parent_->add_producer(tcnt, i->diagonal_only());
+      tcnt = i->count_tasks(tcnt + 1, itensors);
+    }
+  }
+  return tcnt;
+}
+
+
 tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
   Tree::binarycontraction_generate_zero_ci(std::shared_ptr<BinaryContraction> j, int tcnt, int t0, const list<shared_ptr<Tensor>> gamma, vector<shared_ptr<Tensor>> itensors) const {
   OutStream out, tmp;
@@ -560,7 +678,7 @@ tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
   num_ = tcnt;
   for (auto& s : source_tensors) {
     // if it contains a new intermediate tensor, dump a constructor
-    if (find(itensors.begin(), itensors.end(), s) == itensors.end() && s->label().find("I") != string::npos) {
+    if (find(itensors.begin(), itensors.end(), s) == itensors.end() && s->label().find("I") != string::npos && !s->has_alias()) {
       itensors.push_back(s);
 //      out.ee << s->constructor_str_ci(diagonal) << endl;
     }
@@ -609,7 +727,7 @@ tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
 
   ++tcnt;
 
-  return make_tuple(out, tcnt, t0, itensors);
+  return make_tuple(move(out), tcnt, t0, itensors);
 }
 
 
@@ -622,12 +740,13 @@ tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
   num_ = tcnt;
   for (auto& s : source_tensors) {
     // if it contains a new intermediate tensor, dump a constructor
-    if (find(itensors.begin(), itensors.end(), s) == itensors.end() && s->label().find("I") != string::npos) {
+    if (find(itensors.begin(), itensors.end(), s) == itensors.end() && s->label().find("I") != string::npos && !s->has_alias()) {
       itensors.push_back(s);
-      out.ee << s->constructor_str(diagonal) << endl;
+      constructor__(out, s, j, diagonal);
     }
   }
   out << generate_task(num_, source_tensors, gamma, t0, diagonal);
+  out.ee << shared_depend__(num_, j, diagonal);
 
   list<shared_ptr<const Index>> proj = j->target_index();
   // write out headers
@@ -685,7 +804,7 @@ tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
 
   ++tcnt;
 
-  return make_tuple(out, tcnt, t0, itensors);
+  return make_tuple(move(out), tcnt, t0, itensors);
 }
 
 tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
@@ -716,13 +835,15 @@ tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
      else
        tie(tmp, tcnt, t0, itensors) = binarycontraction_generate_zero(j, tcnt, t0, gamma, itensors);
 
-     out << tmp;
+     out << move(tmp);
 
      tie(tmp, tcnt, t0, itensors) = j->generate_task_list(tcnt, t0, gamma, itensors);
-     out << tmp;
+     if (j->hoisted())
+       out.pp.splice(move(tmp.ee));
+     out << move(tmp);
 
    }
-  return make_tuple(out, tcnt, t0, itensors);
+  return make_tuple(move(out), tcnt, t0, itensors);
 }
 
 tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
@@ -734,22 +855,22 @@ tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
   if (depth() == 0) { //////////////////// zero depth /////////////////////////////
     if (root_targets()) {
       tie(tmp, tcnt, t0, itensors) = generate_task_list_zero(tcnt, t0, gamma, itensors);
-      out << tmp;
+      out << move(tmp);
 
     } else {  // trees without root target indices
       out.ee << "  auto " << label() << "q = make_shared<Queue>();" << endl;
       num_ = tcnt;
       for (auto& j : bc_) {
         tie(tmp, tcnt, t0, itensors) = j->generate_task_list(tcnt, t0, gamma, itensors);
-        out << tmp;
+        out << move(tmp);
       }
     }
   } else { //////////////////// non-zero depth /////////////////////////////
     tie(tmp, tcnt, t0, itensors) = generate_steps(indent, tcnt, t0, gamma, itensors);
-    out << tmp;
+    out << move(tmp);
   }
 
-  return make_tuple(out, tcnt, t0, itensors);
+  return make_tuple(move(out), tcnt, t0, itensors);
 }
 
 tuple<OutStream, int, vector<shared_ptr<Tensor>>>
@@ -781,7 +902,7 @@ tuple<OutStream, int, vector<shared_ptr<Tensor>>>
   const bool diagonal = i->diagonal_only();
   for (auto& s : source_tensors) {
     // if it contains a new intermediate tensor, dump a constructor -- somehow this does not work now
-    if (find(itensors.begin(), itensors.end(), s) == itensors.end() && s->label().find("I") != string::npos) {
+    if (find(itensors.begin(), itensors.end(), s) == itensors.end() && s->label().find("I") != string::npos && !s->has_alias()) {
       itensors.push_back(s);
       out.ee << s->constructor_str(diagonal) << endl;
     }
@@ -811,9 +932,9 @@ tuple<OutStream, int, vector<shared_ptr<Tensor>>>
   ++tcnt;
   // triggers a recursive call
   tie(tmp, tcnt, t0, itensors) = i->generate_task_list(tcnt, t0, gamma, itensors);
-  out << tmp;
+  out << move(tmp);
 
-  return make_tuple(out, tcnt, itensors);
+  return make_tuple(move(out), tcnt, itensors);
 }
 
 
@@ -843,46 +964,50 @@ tuple<OutStream, int, vector<shared_ptr<Tensor>>>
   const bool diagonal = i->diagonal_only();
   for (auto& s : source_tensors) {
     // if it contains a new intermediate tensor, dump a constructor -- somehow this does not work now
-    if (find(itensors.begin(), itensors.end(), s) == itensors.end() && s->label().find("I") != string::npos) {
+    if (find(itensors.begin(), itensors.end(), s) == itensors.end() && s->label().find("I") != string::npos && !s->has_alias()) {
       itensors.push_back(s);
-      out.ee << s->constructor_str(diagonal) << endl;
+      constructor__(out, s, i, diagonal);
     }
   }
   // saving a counter to a protected member for dependency checks
   num_ = tcnt;
   out << generate_task(num_, source_tensors, gamma, t0, diagonal);
-
-  // write out headers
-  {
-    list<shared_ptr<const Index>> ti = depth() != 0 ? i->target_indices() : i->target_index();
-    // if outer loop is empty, send inner loop indices to header
-    if (ti.size() == 0) {
-      assert(depth() != 0);
-      list<shared_ptr<const Index>> di = i->loop_indices();
-      di.reverse();
-      out << generate_compute_header(num_, di, source_tensors, true);
-    } else {
-      out << generate_compute_header(num_, ti, source_tensors);
+  out.ee << shared_depend__(num_, i, diagonal);
+
+  // the task classes of an intermediate that is shared between queues are generated only where it is computed first
+  if (!shared_code()) {
+    // write out headers
+    {
+      list<shared_ptr<const Index>> ti = depth() != 0 ? i->target_indices() : i->target_index();
+      // if outer loop is empty, send inner loop indices to header
+      if (ti.size() == 0) {
+        assert(depth() != 0);
+        list<shared_ptr<const Index>> di = i->loop_indices();
+        di.reverse();
+        out << generate_compute_header(num_, di, source_tensors, true);
+      } else {
+        out << generate_compute_header(num_, ti, source_tensors);
+      }
     }
-  }
-
-  // use virtual function to generate a task for this binary contraction
-  out << generate_bc(i);
 
-  {
-    // send outer loop indices if outer loop indices exist, otherwise send inner indices
-    list<shared_ptr<const Index>> ti = depth() != 0 ? i->target_indices() : i->target_index();
-    if (depth() == 0)
-      for (auto i = ti.begin(), j = ++ti.begin(); i != ti.end(); ++i, ++i, ++j, ++j)
-        swap(*i, *j);
-    if (ti.size() == 0) {
-      assert(depth() != 0);
-      // sending inner indices
-      list<shared_ptr<const Index>> di = i->loop_indices();
-      out << generate_compute_footer(num_, di, source_tensors, true);
-    } else {
-      // sending outer indices
-      out << generate_compute_footer(num_, ti, source_tensors, false);
+    // use virtual function to generate a task for this binary contraction
+    out << generate_bc(i);
+
+    {
+      // send outer loop indices if outer loop indices exist, otherwise send inner indices
+      list<shared_ptr<const Index>> ti = depth() != 0 ? i->target_indices() : i->target_index();
+      if (depth() == 0)
+        for (auto i = ti.begin(), j = ++ti.begin(); i != ti.end(); ++i, ++i, ++j, ++j)
+          swap(*i, *j);
+      if (ti.size() == 0) {
+        assert(depth() != 0);
+        // sending inner indices
+        list<shared_ptr<const Index>> di = i->loop_indices();
+        out << generate_compute_footer(num_, di, source_tensors, true);
+      } else {
+        // sending outer indices
+        out << generate_compute_footer(num_, ti, source_tensors, false);
+      }
     }
   }
   ///////////////////////////////////////////////////////////////////////
@@ -891,9 +1016,11 @@ tuple<OutStream, int, vector<shared_ptr<Tensor>>>
   ++tcnt;
   // triggers a recursive call
   tie(tmp, tcnt, t0, itensors) = i->generate_task_list(tcnt, t0, gamma, itensors);
-  out << tmp;
+  if (i->hoisted())
+    out.pp.splice(move(tmp.ee));
+  out << move(tmp);
 
-  return make_tuple(out, tcnt, itensors);
+  return make_tuple(move(out), tcnt, itensors);
 }
 
 
@@ -933,9 +1060,11 @@ tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
       uniq_tensors.push_back(i);
     }
 
-    out << generate_compute_header(tcnt, ti, uniq_tensors);
-    out << generate_compute_operators(target_, op_);
-    out << generate_compute_footer(tcnt, ti, uniq_tensors, false);
+    if (!shared_code()) {
+      out << generate_compute_header(tcnt, ti, uniq_tensors);
+      out << generate_compute_operators(target_, op_);
+      out << generate_compute_footer(tcnt, ti, uniq_tensors, false);
+    }
 
     ++tcnt;
   }
@@ -954,10 +1083,10 @@ tuple<OutStream, int, int, vector<shared_ptr<Tensor>>>
     else
       tie(tmp, tcnt, itensors) = binarycontraction_generate(i, tcnt, gamma, t0, itensors);
 
-    out << tmp;
+    out << move(tmp);
   }
 
-  return make_tuple(out, tcnt, t0, itensors);
+  return make_tuple(move(out), tcnt, t0, itensors);
 }
 
 
@@ -982,6 +1111,24 @@ bool BinaryContraction::diagonal_only() const {
 }
 
 
+bool Tree::gamma_kept() const {
+  return Forest::hoist() && iterated();
+}
+
+
+bool BinaryContraction::invariant() const {
+  return !tensor_->amplitude()
+      && all_of(subtree_.begin(), subtree_.end(), [](shared_ptr<Tree> i){ return i->invariant(); })
+      && (!source_ || !source_->amplitude());
+}
+
+
+bool Tree::invariant() const {
+  return none_of(op_.begin(), op_.end(), [](shared_ptr<Tensor> i){ return i->amplitude(); })
+      && all_of(bc_.begin(), bc_.end(), [](shared_ptr<BinaryContraction> i){ return i->invariant(); });
+}
+
+
 bool BinaryContraction::nogamma_upstream() const {
   return tensor_->label().find("Gamma") == std::string::npos
       && parent_->nogamma_upstream();
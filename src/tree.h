@@ -58,6 +58,15 @@ class BinaryContraction {
     /// Target indices, could be from excitation operator target indices, or ci derivative target index.
     std::list<std::shared_ptr<const Index>> target_index_;
 
+    /// Binary contraction that computes the same intermediate as subtree_ first (see Forest::share_intermediates), and whether it is in the same queue.
+    std::shared_ptr<BinaryContraction> shared_;
+    bool shared_queue_ = false;
+    /// Number of the first task of subtree_, and the tasks that add to its intermediate with whether they are for diagonals only. Set by count_tasks.
+    mutable int first_task_ = -1;
+    mutable std::vector<std::pair<int,bool>> producers_;
+    /// If true, subtree_ is computed once before the iterations into an intermediate that is kept (see Forest::hoist_invariants).
+    bool hoisted_ = false;
+
   public:
     /// Construct binary contraction from subtree and tensor if diagram has excitation operator target indices, index list will not be empty.
     BinaryContraction(std::list<std::shared_ptr<Tree>> o, std::shared_ptr<Tensor> t, std::list<std::shared_ptr<const Index>> ti) : tensor_(t), subtree_(o), target_index_(ti) { }
@@ -111,6 +120,27 @@ class BinaryContraction {
     /// If transpose.
     bool dagger() const;
 
+    /// Makes o compute the intermediate of subtree_. In the same queue subtree_ is not generated; otherwise its task classes are those of o.
+    void set_shared(std::shared_ptr<BinaryContraction> o, const bool same_queue) { shared_ = o; shared_queue_ = same_queue; }
+    /// Returns the binary contraction that computes the intermediate of subtree_, if it is shared.
+    std::shared_ptr<BinaryContraction> shared() const { return shared_; }
+    /// Returns true if subtree_ is computed by another binary contraction in the same queue.
+    bool shared_queue() const { return shared_ && shared_queue_; }
+    /// Returns true if the task classes of subtree_ are those of another binary contraction.
+    bool shared_code() const { return shared_ && !shared_queue_; }
+    /// Makes subtree_ computed once before the iterations.
+    void set_hoisted() { hoisted_ = true; }
+    /// Returns true if subtree_ is computed once before the iterations.
+    bool hoisted() const { return hoisted_; }
+    /// Returns true if no amplitude enters this binary contraction.
+    bool invariant() const;
+    /// Records a task that adds to the intermediate of subtree_.
+    void add_producer(const int ic, const bool diagonal) const { producers_.push_back(std::make_pair(ic, diagonal)); }
+    /// Returns the tasks that add to the intermediate of subtree_.
+    const std::vector<std::pair<int,bool>>& producers() const { return producers_; }
+    /// Returns the number of the first task of subtree_.
+    int first_task() const { return first_task_; }
+
     /// Returns node above.
     Tree* parent() { return parent_; }
     /// Returns const node above.
@@ -130,6 +160,8 @@ class BinaryContraction {
     /// Calls generate_task_list for subtree.
     std::tuple<OutStream, int, int, std::vector<std::shared_ptr<Tensor>>>
         generate_task_list(int tcnt, int t0, const std::list<std::shared_ptr<Tensor>> gamma, std::vector<std::shared_ptr<Tensor>> itensors) const;
+    /// Calls count_tasks for subtree and returns the next task number.
+    int count_tasks(int tcnt, std::vector<std::shared_ptr<Tensor>>& itensors) const;
 
 };
 
@@ -239,6 +271,16 @@ class Tree {
     bool diagonal_only() const { return gather_gamma().empty() && nogamma_upstream(); }
     /// Returns if gamma_ is multiplied in the upstream
     bool nogamma_upstream() const { return !parent_ || parent_->nogamma_upstream(); }
+    /// Returns if the task classes of this tree are generated elsewhere, so that only the queue is generated
+    bool shared_code() const { return parent_ && (parent_->shared_code() || parent_->parent()->shared_code()); }
+    /// Returns true if this tree is computed once before the iterations (see Forest::hoist_invariants)
+    bool hoisted() const { return parent_ && (parent_->hoisted() || parent_->parent()->hoisted()); }
+    /// Returns true if no amplitude enters this tree
+    bool invariant() const;
+    /// Returns true if this tree is computed in every iteration with the same Gamma tensors, i.e., it is the CASPT2 residual
+    bool iterated() const { return parent_ ? parent_->parent()->iterated() : label_ == "residual" && (tree_name_ == "CASPT2" || tree_name_ == "RelCASPT2"); }
+    /// Returns true if this tree reads the Gamma tensors computed once by the precompute queue instead of computing them
+    bool gamma_kept() const;
 
     /// This function returns the rank of required RDMs here + inp. Goes through bc_ and op_ tensor lists.
     std::vector<std::string> required_rdm(std::vector<std::string> inp) const;
@@ -248,6 +290,8 @@ class Tree {
     /// Generate task and task list files.
     std::tuple<OutStream, int, int, std::vector<std::shared_ptr<Tensor>>>
         generate_task_list(int tcnt, int t0, const std::list<std::shared_ptr<Tensor>> gamma, std::vector<std::shared_ptr<Tensor>> itensors) const;
+    /// Returns the task number after those generate_task_list makes from tcnt, and adds the intermediates it constructs to itensors in the same order. No code is generated.
+    int count_tasks(int tcnt, std::vector<std::shared_ptr<Tensor>>& itensors) const;
     /// Generate code by stepping through op and bc.
     std::tuple<OutStream, int, int, std::vector<std::shared_ptr<Tensor>>>
         generate_steps(const std::string indent, int tcnt, int t0, const std::list<std::shared_ptr<Tensor>> gamma, std::vector<std::shared_ptr<Tensor>> itensors) const;